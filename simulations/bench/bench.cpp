@@ -0,0 +1,48 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "engine/delta_notch.h"
+#include "engine/pso.h"
+#include "engine/random_walk.h"
+
+using namespace std;
+
+// Steps/sec of every engine with no rendering in the way:
+//   sim_bench [seconds per engine]
+
+// Helper function to step `step` repeatedly for about `seconds` and print the rate
+template <typename StepFunction>
+void bench(const string& name, double seconds, StepFunction step) {
+    long long num_steps = 0;
+    auto start = chrono::steady_clock::now();
+    double elapsed_s = 0.0;
+    while (elapsed_s < seconds) {
+        // check the clock every 1000 steps so it doesn't dominate the cheap engines
+        for (int step_i = 0; step_i < 1000; ++step_i) {
+            step();
+        }
+        num_steps += 1000;
+        elapsed_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    cout << name << ": " << num_steps / elapsed_s << " steps/s (" << num_steps << " steps in " << elapsed_s << " s)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+
+    PSOEngine pso_engine(DEFAULT_PSO_CONFIG, mt19937(314));
+    bench("pso", seconds, [&pso_engine] { pso_engine.step(); });
+
+    mt19937 gen(314);
+    auto grid_result = get_grid(32, 32, gen);
+    TissueCSR tissue = adjs_to_csr(grid_result.first);
+    DeltaNotchEngine delta_notch_engine(tissue.graph(), {grid_result.second, 0.0, gen});
+    bench("delta_notch (32x32)", seconds, [&delta_notch_engine] { delta_notch_engine.step(); });
+
+    RandomWalkEngine random_walk_engine(100, 100, mt19937(314));
+    bench("random_walk", seconds, [&random_walk_engine] { random_walk_engine.step(); });
+    return 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Compact binary checkpoints: a 4 byte magic tag, a format version, then raw
+// little-endian-as-written PODs. Files are meant to be read back on the same
+// kind of machine that wrote them, so there is no byte swapping.
+
+// 2: ssa checkpoints also hold the pending rxn time
+// 3: rng state words are stored as uint32 instead of uint64
+const uint32_t CHECKPOINT_VERSION = 3;
+
+template <typename T>
+void write_pod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_pod(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+template <typename T>
+void write_array(std::ostream& out, const std::vector<T>& values) {
+    write_pod(out, static_cast<uint64_t>(values.size()));
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+// Helper function for how many bytes are left to read, or UINT64_MAX if the stream can't tell
+inline uint64_t bytes_left(std::istream& in) {
+    std::streampos here = in.tellg();
+    if (here == std::streampos(-1)) {
+        return UINT64_MAX;
+    }
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(here);
+    return end > here ? static_cast<uint64_t>(end - here) : 0;
+}
+
+// The size comes from the file, so it is checked against what's left of it before
+// anything is allocated: a corrupt count just fails the read
+template <typename T>
+bool read_array(std::istream& in, std::vector<T>& values) {
+    uint64_t size;
+    if (!read_pod(in, size) || size > bytes_left(in) / sizeof(T)) {
+        return false;
+    }
+    values.resize(size);
+    in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+    return static_cast<bool>(in);
+}
+
+// Header is the magic tag followed by the format version
+inline void write_checkpoint_header(std::ostream& out, const char magic[4]) {
+    out.write(magic, 4);
+    write_pod(out, CHECKPOINT_VERSION);
+}
+
+inline bool read_checkpoint_header(std::istream& in, const char magic[4]) {
+    char file_magic[4];
+    uint32_t version;
+    in.read(file_magic, 4);
+    if (!in || memcmp(file_magic, magic, 4) != 0) {
+        std::cerr << "Not a " << std::string(magic, 4) << " checkpoint." << std::endl;
+        return false;
+    }
+    if (!read_pod(in, version) || version != CHECKPOINT_VERSION) {
+        std::cerr << "Unsupported checkpoint version." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// The standard only exposes the exact mt19937 state through its text
+// representation, so pack those numbers into 32-bit binary words (what mt19937
+// holds) instead of storing the text itself, which takes about 11 bytes a word
+inline void write_rng(std::ostream& out, const std::mt19937& gen) {
+    std::stringstream text;
+    text << gen;
+    std::vector<uint32_t> words;
+    uint32_t word;
+    while (text >> word) {
+        words.push_back(word);
+    }
+    write_array(out, words);
+}
+
+inline bool read_rng(std::istream& in, std::mt19937& gen) {
+    std::vector<uint32_t> words;
+    if (!read_array(in, words)) {
+        return false;
+    }
+    std::stringstream text;
+    for (uint32_t word : words) {
+        text << word << ' ';
+    }
+    text >> gen;
+    return !text.fail();
+}
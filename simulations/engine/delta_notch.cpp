@@ -0,0 +1,509 @@
+#include "delta_notch.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib> // For random number generation
+#include <ctime>   // For seeding the random number generator
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <cstring>
+
+#include "checkpoint.h"
+#include "instrument.h"
+
+using namespace std;
+
+void init_propensity_tree(PropensityTree& tree, int num_rxns) {
+    tree.num_leaves = 1;
+    while (tree.num_leaves < num_rxns) {
+        tree.num_leaves *= 2;
+    }
+    tree.nodes.assign(2 * tree.num_leaves, 0.0);
+}
+
+// Internal nodes are always recomputed from their children (never updated by
+// differences), so the tree never drifts and only depends on its leaves
+void set_propensity(PropensityTree& tree, int rxn_i, double propensity) {
+    int node = tree.num_leaves + rxn_i;
+    tree.nodes[node] = propensity;
+    for (node /= 2; node >= 1; node /= 2) {
+        tree.nodes[node] = tree.nodes[2 * node] + tree.nodes[2 * node + 1];
+    }
+}
+
+// Helper function for choosing a rxn from the discrete distribution given by the
+// relative probabilities in `rxn_propensities`, by walking down the sum tree
+int choose_a_rxn(const PropensityTree& rxn_propensities, mt19937& gen) {
+
+    // Validate sizes
+    if (rxn_propensities.num_leaves == 0 || rxn_propensities.total() <= 0.0) {
+        cerr << "Invalid input sizes or empty vectors." << endl;
+        return 1; // Return an error code
+    }
+
+    uniform_real_distribution<double> distribution(0.0, 1.0);
+    double target = distribution(gen) * rxn_propensities.total();
+
+    int node = 1;
+    while (node < rxn_propensities.num_leaves) {
+        double left = rxn_propensities.nodes[2 * node];
+        double right = rxn_propensities.nodes[2 * node + 1];
+        // rounding can push target past a subtree's sum, never step into an empty one
+        if ((target < left && left > 0.0) || right <= 0.0) {
+            node = 2 * node;
+        } else {
+            target -= left;
+            node = 2 * node + 1;
+        }
+    }
+    return node - rxn_propensities.num_leaves;
+}
+
+// Helper function to generate a random integer in the specified range [min, max]
+static int get_random_int(int min, int max, mt19937 gen) {
+    uniform_int_distribution<int> random_int_distribution(min, max);
+    int random_int = random_int_distribution(gen);
+    return random_int;
+}
+
+pair<vector<vector<int>>, vector<int>> get_grid(int nx, int ny, mt19937 gen) {
+    vector<vector<int>> adjs;
+    for (int i = 0; i < nx; ++i) {
+        for (int j = 0; j < ny; ++j) {
+            vector<int> adj;
+            // adjs is a list of the 6 neighbors for each cell
+            for (auto [x, y] : vector<pair<int, int>>{{i - 1, j - 1}, {i, j - 1}, {i - 1, j},
+                                                               {i + 1, j}, {i, j + 1}, {i + 1, j + 1}}) {
+                // index of neighbor if neighbor exists
+                // None if no neighbors bc fictitious cells give 0 for D_bar, don'time affect anything
+                adj.push_back((x >= 0 && x < nx && y >= 0 && y < ny) ? (x * ny + y) : -1);
+            }
+            adjs.push_back(adj);
+        }
+    }
+
+    vector<int> initial_compartments; // initial_compartments is all the compartments for all cells: N D Z
+    for (int i = 0; i < nx * ny; ++i) {
+        int N = get_random_int(19, 20, gen);
+        int Z = 20;
+        int D = 0;
+        initial_compartments.push_back(N);
+        initial_compartments.push_back(D);
+        initial_compartments.push_back(Z);
+    }
+
+    return {adjs, initial_compartments};
+}
+
+
+static double f(double x) {
+    return (x * x) / (0.01 + (x * x));
+}
+
+// N: (cell_i*3)
+// D: (cell_i*3)+1
+// Z: (cell_i*3)+2
+static double rxn0_propensity(int cell_i, const vector<int>& compartments, const TissueGraph& tissue) {
+    // zero condition: if N+1 > Z
+    double Z = compartments[(cell_i * 3) + 2];
+    double N = compartments[cell_i * 3];
+    
+    if (N + 1 > Z) {
+        return 0.0;
+    } else {
+        double D_bar = 0.0;
+        for (uint64_t edge_i = tissue.row_offsets[cell_i]; edge_i < tissue.row_offsets[cell_i + 1]; ++edge_i) {
+            D_bar += compartments[(tissue.neighbors[edge_i] * 3) + 1];
+        }
+        return Z * f(D_bar / Z);
+    }
+}
+
+static double rxn1_propensity(int cell_i, const vector<int>& compartments, const TissueGraph& tissue) {
+    // zero condition: if N-1 < 0
+    double N = compartments[cell_i * 3];
+    
+    if (N - 1 < 0) {
+        return 0.0;
+    } else {
+        return N;
+    }
+}
+
+static double rxn2_propensity(int cell_i, const vector<int>& compartments, const TissueGraph& tissue) {
+    // zero condition: if D+1 > Z
+    double Z = compartments[(cell_i * 3) + 2];
+    double D = compartments[(cell_i * 3) + 1];
+    
+    if (D + 1 > Z) {
+        return 0.0;
+    } else {
+        double N = compartments[cell_i * 3];
+        return Z * (1 - f(N / Z));
+    }
+}
+
+static double rxn3_propensity(int cell_i, const vector<int>& compartments, const TissueGraph& tissue) {
+    // zero condition: if D-1 < 0
+    double D = compartments[(cell_i * 3) + 1];
+    
+    if (D - 1 < 0) {
+        return 0.0;
+    } else {
+        return D;
+    }
+}
+
+// Recompute all 4 rxn propensities of one cell
+static void update_cell_propensities(int cell_i, const vector<int>& compartments, const TissueGraph& tissue, PropensityTree& rxn_propensities) {
+    int num_rxns_per_cell = 4;
+    set_propensity(rxn_propensities, (cell_i*num_rxns_per_cell) + 0, rxn0_propensity(cell_i, compartments, tissue)); // Rxn 0
+    set_propensity(rxn_propensities, (cell_i*num_rxns_per_cell) + 1, rxn1_propensity(cell_i, compartments, tissue)); // Rxn 1
+    set_propensity(rxn_propensities, (cell_i*num_rxns_per_cell) + 2, rxn2_propensity(cell_i, compartments, tissue)); // Rxn 2
+    set_propensity(rxn_propensities, (cell_i*num_rxns_per_cell) + 3, rxn3_propensity(cell_i, compartments, tissue)); // Rxn 3
+}
+
+// Full propensity computation. Needed once at the start of a run (or after loading a
+// checkpoint); after that ssa_step only updates the cells a rxn actually touched
+void init_propensities(const SSAState& state, const TissueGraph& tissue, PropensityTree& rxn_propensities) {
+    int num_rxns_per_cell = 4;
+    init_propensity_tree(rxn_propensities, tissue.num_cells * num_rxns_per_cell);
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        int first_leaf = rxn_propensities.num_leaves + (cell_i*num_rxns_per_cell);
+        rxn_propensities.nodes[first_leaf + 0] = rxn0_propensity(cell_i, state.compartments, tissue);
+        rxn_propensities.nodes[first_leaf + 1] = rxn1_propensity(cell_i, state.compartments, tissue);
+        rxn_propensities.nodes[first_leaf + 2] = rxn2_propensity(cell_i, state.compartments, tissue);
+        rxn_propensities.nodes[first_leaf + 3] = rxn3_propensity(cell_i, state.compartments, tissue);
+    }
+    for (int node = rxn_propensities.num_leaves - 1; node >= 1; --node) {
+        rxn_propensities.nodes[node] = rxn_propensities.nodes[2 * node] + rxn_propensities.nodes[2 * node + 1];
+    }
+}
+
+// Advance the ssa by a single rxn. Returns false once the total propensity is 0,
+// in which case time is pushed to time_end. `rxn_propensities` is caller-owned scratch
+// set up by init_propensities and kept up to date here, so stepping never touches the heap
+bool ssa_step(SSAState& state, const TissueGraph& tissue, double time_end, PropensityTree& rxn_propensities, int* fired_rxn) {
+    vector<int>& compartments = state.compartments;
+
+    // 1. sample tau, unless a rxn is already pending (propensities can't have changed since,
+    // nothing fired in between), and advance time
+    if (state.next_rxn_time == SSAState::NO_PENDING_RXN) {
+        double total_propensity = rxn_propensities.total();
+        if (total_propensity <= 0.0) { // no more rxns, time runs on to time_end if there is one
+            if (isfinite(time_end)) {
+                state.time = max(state.time, time_end);
+            }
+            return false;
+        }
+        uniform_real_distribution<double> distribution(0.0, 1.0);
+        double u1 = distribution(state.gen);
+        double tau = -log(u1) / total_propensity;
+        state.next_rxn_time = state.time + tau;
+    }
+    if (state.next_rxn_time > time_end) { // don't fire past time_end, keep it for the next step
+        state.time = max(state.time, time_end);
+        return false;
+    }
+    state.time = state.next_rxn_time;
+    state.next_rxn_time = SSAState::NO_PENDING_RXN;
+
+    // 2. draw rxn
+    int i;
+    {
+        INSTRUMENT_SCOPE("choose_a_rxn");
+        i = choose_a_rxn(rxn_propensities, state.gen);
+    }
+
+    // 3. apply rxn
+    int rxn_type = i % 4;
+    int cell_selected = i / 4;
+    if (fired_rxn != nullptr) {
+        *fired_rxn = i;
+    }
+    {
+        INSTRUMENT_SCOPE("apply");
+        INSTRUMENT_COUNT("rxns fired", 1);
+        // N: (cell_i*3)
+        // D: (cell_i*3)+1
+        // Z: (cell_i*3)+2
+        if (rxn_type == 0) {
+            compartments[(cell_selected * 3)] = compartments[(cell_selected * 3)] + 1;
+        } else if (rxn_type == 1) {
+            compartments[(cell_selected * 3)] = compartments[(cell_selected * 3)] - 1;
+        } else if (rxn_type == 2) {
+            compartments[(cell_selected * 3) + 1] = compartments[(cell_selected * 3) + 1] + 1;
+        } else if (rxn_type == 3) {
+            compartments[(cell_selected * 3) + 1] = compartments[(cell_selected * 3) + 1] - 1;
+        }
+    }
+
+    // 4. update the propensities that depend on what changed:
+    // N and D only enter the selected cell's own rxns, except that
+    // D also enters rxn 0 of each neighbor through D_bar
+    INSTRUMENT_SCOPE("propensity recompute");
+    update_cell_propensities(cell_selected, compartments, tissue, rxn_propensities);
+    if (rxn_type == 2 || rxn_type == 3) {
+        for (uint64_t edge_i = tissue.row_offsets[cell_selected]; edge_i < tissue.row_offsets[cell_selected + 1]; ++edge_i) {
+            int neighbor_i = tissue.neighbors[edge_i];
+            set_propensity(rxn_propensities, (neighbor_i * 4) + 0, rxn0_propensity(neighbor_i, compartments, tissue));
+        }
+    }
+    return true;
+}
+
+// Helper function for whether a cell counts as low-N in the pattern
+static bool is_low_cell(int cell_i, const vector<int>& compartments, double low_fraction) {
+    return compartments[cell_i * 3] < low_fraction * compartments[(cell_i * 3) + 2];
+}
+
+void init_pattern_monitor(PatternMonitor& monitor, const vector<int>& compartments, const TissueGraph& tissue, double low_fraction) {
+    monitor.low_fraction = low_fraction;
+    monitor.is_low.assign(tissue.num_cells, 0);
+    monitor.num_low_neighbors.assign(tissue.num_cells, 0);
+    monitor.num_isolated_low = 0;
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        monitor.is_low[cell_i] = is_low_cell(cell_i, compartments, low_fraction);
+    }
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        for (uint64_t edge_i = tissue.row_offsets[cell_i]; edge_i < tissue.row_offsets[cell_i + 1]; ++edge_i) {
+            monitor.num_low_neighbors[cell_i] += monitor.is_low[tissue.neighbors[edge_i]];
+        }
+        if (monitor.is_low[cell_i] && monitor.num_low_neighbors[cell_i] == 0) {
+            ++monitor.num_isolated_low;
+        }
+    }
+}
+
+void update_pattern_monitor(PatternMonitor& monitor, int cell_i, const vector<int>& compartments, const TissueGraph& tissue) {
+    bool is_low = is_low_cell(cell_i, compartments, monitor.low_fraction);
+    if (is_low == static_cast<bool>(monitor.is_low[cell_i])) {
+        return; // N moved but the cell stayed on the same side of the threshold
+    }
+    int change = is_low ? 1 : -1;
+
+    // the cell itself: counts as isolated iff it is low with no low neighbors
+    monitor.is_low[cell_i] = is_low;
+    if (monitor.num_low_neighbors[cell_i] == 0) {
+        monitor.num_isolated_low += change;
+    }
+
+    // its neighbors: a low neighbor stops (or starts) being isolated when its count leaves (or hits) 0
+    for (uint64_t edge_i = tissue.row_offsets[cell_i]; edge_i < tissue.row_offsets[cell_i + 1]; ++edge_i) {
+        int neighbor_i = tissue.neighbors[edge_i];
+        int before = monitor.num_low_neighbors[neighbor_i];
+        monitor.num_low_neighbors[neighbor_i] = before + change;
+        if (monitor.is_low[neighbor_i]) {
+            if (before == 0) {
+                --monitor.num_isolated_low;
+            } else if (before + change == 0) {
+                ++monitor.num_isolated_low;
+            }
+        }
+    }
+}
+
+// Checkpoint layout: "DNCK", version, compartments, time, pending rxn time, rng state
+bool save_ssa_checkpoint(const string& path, const SSAState& state) {
+    // write to a temporary file first so a crash mid-save never clobbers the last good checkpoint
+    string tmp_path = path + ".tmp";
+    ofstream out(tmp_path, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Could not open " << tmp_path << " for writing." << endl;
+        return false;
+    }
+    write_checkpoint_header(out, "DNCK");
+    write_array(out, state.compartments);
+    write_pod(out, state.time);
+    write_pod(out, state.next_rxn_time);
+    write_rng(out, state.gen);
+    out.close();
+    if (!out || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        cerr << "Could not write checkpoint " << path << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_ssa_checkpoint(const string& path, SSAState& state) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        cerr << "Could not open " << path << "." << endl;
+        return false;
+    }
+    if (!read_checkpoint_header(in, "DNCK")
+        || !read_array(in, state.compartments)
+        || !read_pod(in, state.time)
+        || !read_pod(in, state.next_rxn_time)
+        || !read_rng(in, state.gen)) {
+        cerr << "Corrupt checkpoint " << path << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Run the ssa from `state` (fresh or restored from a checkpoint) until time_end.
+// If `checkpoint_path` is set, the state is saved every `checkpoint_every` rxns and at the end
+pair<vector<double>, vector<vector<int>>> ssa_delta_notch(SSAState state,
+                                                const TissueGraph& tissue,
+                                                double time_end,
+                                                string checkpoint_path,
+                                                int checkpoint_every) {
+    vector<double> times = {state.time}; // initialize times
+    vector<vector<int>> compartment_solutions = {state.compartments};
+
+    DeltaNotchEngine engine(tissue, state);
+    engine.add_observer([&times, &compartment_solutions](const SSAState& state) {
+        INSTRUMENT_SCOPE("compartment_solutions push");
+        compartment_solutions.push_back(state.compartments);
+        times.push_back(state.time);
+    });
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint_every(checkpoint_path, checkpoint_every);
+    }
+
+    cout << "running ssa simulation..." << endl;
+    engine.run_until(time_end);
+    if (!engine.rxns_left()) {
+        cout << "rxns ended" << endl;
+    }
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint(checkpoint_path);
+    }
+
+    return {times, compartment_solutions};
+}
+
+pair<vector<double>, vector<vector<int>>> ssa_delta_notch(vector<int> initial_compartments,
+                                                vector<vector<int>> adjs,
+                                                double time_end,
+                                                mt19937 gen) {
+    SSAState state = {initial_compartments, 0.0, gen};
+    TissueCSR tissue = adjs_to_csr(adjs);
+    return ssa_delta_notch(state, tissue.graph(), time_end, "", 0);
+}
+
+const double MIN_DEFAULT_CONVERGENCE_TOLERANCE = 0.03;
+const double CONVERGENCE_TOLERANCE_CELLS = 4.0;
+
+double default_convergence_tolerance(int num_cells) {
+    return max(MIN_DEFAULT_CONVERGENCE_TOLERANCE, CONVERGENCE_TOLERANCE_CELLS / max(num_cells, 1));
+}
+
+// ENGINE =============================================================
+// Cells with N below half of Z count as low
+const double PATTERN_LOW_FRACTION = 0.5;
+
+DeltaNotchEngine::DeltaNotchEngine(TissueGraph tissue, SSAState state)
+    : m_tissue(tissue), m_state(state)
+{
+    init_propensities(m_state, m_tissue, m_propensities);
+    init_pattern_monitor(m_monitor, m_state.compartments, m_tissue, PATTERN_LOW_FRACTION);
+    reset_convergence();
+}
+
+bool DeltaNotchEngine::step()
+{
+    int fired_rxn;
+    bool fired = ssa_step(m_state, m_tissue, numeric_limits<double>::infinity(), m_propensities, &fired_rxn);
+    if (fired) {
+        track_pattern(fired_rxn);
+        for (const Observer& observer : m_observers) {
+            observer(m_state);
+        }
+    }
+    return fired;
+}
+
+void DeltaNotchEngine::run_until(double time)
+{
+    while (m_state.time < time && !(m_stops_on_convergence && m_converged)) {
+        int fired_rxn;
+        if (!ssa_step(m_state, m_tissue, time, m_propensities, &fired_rxn)) {
+            break;
+        }
+        track_pattern(fired_rxn);
+        for (const Observer& observer : m_observers) {
+            observer(m_state);
+        }
+    }
+}
+
+void DeltaNotchEngine::stop_on_convergence(ConvergenceCriteria criteria)
+{
+    m_stops_on_convergence = true;
+    m_criteria = criteria;
+    reset_convergence();
+}
+
+void DeltaNotchEngine::track_pattern(int fired_rxn)
+{
+    int rxn_type = fired_rxn % 4;
+    if (rxn_type == 0 || rxn_type == 1) { // only N changes can move the order parameter
+        update_pattern_monitor(m_monitor, fired_rxn / 4, m_state.compartments, m_tissue);
+    }
+    if (!m_stops_on_convergence) {
+        return;
+    }
+
+    // restart the window whenever the order parameter leaves the band around where it started
+    double order_parameter = m_monitor.order_parameter();
+    if (abs(order_parameter - m_window_order_parameter) > m_criteria.tolerance) {
+        m_window_start_time = m_state.time;
+        m_window_order_parameter = order_parameter;
+    }
+    m_converged = m_state.time - m_window_start_time >= m_criteria.window;
+}
+
+void DeltaNotchEngine::reset_convergence()
+{
+    m_window_start_time = m_state.time;
+    m_window_order_parameter = m_monitor.order_parameter();
+    m_converged = false;
+}
+
+void DeltaNotchEngine::add_observer(Observer observer)
+{
+    m_observers.push_back(observer);
+}
+
+void DeltaNotchEngine::save_checkpoint_every(const string& path, long long every)
+{
+    if (every <= 0) {
+        return;
+    }
+    long long num_rxns = 0;
+    add_observer([path, every, num_rxns](const SSAState& state) mutable {
+        if (++num_rxns % every == 0) {
+            save_ssa_checkpoint(path, state);
+        }
+    });
+}
+
+bool DeltaNotchEngine::save_checkpoint(const string& path) const
+{
+    return save_ssa_checkpoint(path, m_state);
+}
+
+bool DeltaNotchEngine::load_checkpoint(const string& path)
+{
+    SSAState state = m_state;
+    if (!load_ssa_checkpoint(path, state)) {
+        return false;
+    }
+    if (state.compartments.size() != static_cast<size_t>(m_tissue.num_cells) * 3) {
+        cerr << "Checkpoint does not match the tissue's " << m_tissue.num_cells << " cells." << endl;
+        return false;
+    }
+    m_state = state;
+    init_propensities(m_state, m_tissue, m_propensities);
+    init_pattern_monitor(m_monitor, m_state.compartments, m_tissue, PATTERN_LOW_FRACTION);
+    reset_convergence();
+    return true;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tissue.h"
+
+// Delta-notch lateral inhibition as a stochastic simulation (ssa) on a tissue of cells.
+// Compartments are N D Z per cell:
+// N: (cell_i*3)
+// D: (cell_i*3)+1
+// Z: (cell_i*3)+2
+
+// Everything needed to pick an ssa run back up exactly where it left off
+struct SSAState {
+    std::vector<int> compartments;
+    double time;
+    std::mt19937 gen;
+    // When the next rxn fires, once drawn. A step that would fire past its time_end
+    // leaves the rxn pending here instead, so the next step fires it at its true time
+    double next_rxn_time = NO_PENDING_RXN;
+
+    static constexpr double NO_PENDING_RXN = -1.0;
+};
+
+// Propensities of every rxn (4 per cell) as the leaves of a binary sum tree, so
+// changing one rxn and drawing a rxn are both O(log rxns) instead of O(rxns).
+// nodes[1] is the root (the total propensity), the children of node k are 2k and 2k+1,
+// and the leaves start at nodes[num_leaves]
+struct PropensityTree {
+    std::vector<double> nodes;
+    int num_leaves = 0;
+
+    double total() const { return nodes[1]; }
+};
+
+// nx and ny are cells on the x and y sides of a hex grid; returns the adjacency
+// (6 per cell, -1 for no neighbor) and the initial compartments
+std::pair<std::vector<std::vector<int>>, std::vector<int>> get_grid(int nx, int ny, std::mt19937 gen);
+
+void init_propensity_tree(PropensityTree& tree, int num_rxns);
+void set_propensity(PropensityTree& tree, int rxn_i, double propensity);
+int choose_a_rxn(const PropensityTree& rxn_propensities, std::mt19937& gen);
+
+// Full propensity computation, needed once at the start of a run or after loading a checkpoint
+void init_propensities(const SSAState& state, const TissueGraph& tissue, PropensityTree& rxn_propensities);
+
+// Advance the ssa by a single rxn. Returns false if no rxn fired: either none are left,
+// or the next one comes after time_end, in which case time stops at time_end and the
+// rxn stays pending. With an infinite time_end (no target) time stays put if none fired. If `fired_rxn` is given it is set to the rxn that fired (cell_i*4 + rxn type)
+bool ssa_step(SSAState& state, const TissueGraph& tissue, double time_end, PropensityTree& rxn_propensities,
+              int* fired_rxn = nullptr);
+
+bool save_ssa_checkpoint(const std::string& path, const SSAState& state);
+bool load_ssa_checkpoint(const std::string& path, SSAState& state);
+
+// Full history runs: the time and compartments after every rxn
+std::pair<std::vector<double>, std::vector<std::vector<int>>> ssa_delta_notch(SSAState state,
+                                                                              const TissueGraph& tissue,
+                                                                              double time_end,
+                                                                              std::string checkpoint_path,
+                                                                              int checkpoint_every);
+std::pair<std::vector<double>, std::vector<std::vector<int>>> ssa_delta_notch(std::vector<int> initial_compartments,
+                                                                              std::vector<std::vector<int>> adjs,
+                                                                              double time_end,
+                                                                              std::mt19937 gen);
+
+// CONVERGENCE =============================================================
+// Lateral inhibition settles into scattered low-N (D-expressing) cells, each surrounded
+// by high-N cells. The order parameter is the fraction of all cells that are low-N
+// (N < low_fraction * Z) with no low-N neighbors. Only rxns 0 and 1 change N, so after
+// one of them only the fired cell and its neighbors need looking at: O(degree) per rxn,
+// i.e. O(1) on a hex grid
+struct PatternMonitor {
+    double low_fraction;
+    std::vector<char> is_low;
+    std::vector<int> num_low_neighbors;
+    int num_isolated_low = 0; // low cells with num_low_neighbors == 0
+
+    double order_parameter() const { return is_low.empty() ? 0.0 : static_cast<double>(num_isolated_low) / is_low.size(); }
+};
+
+// Full recompute, needed once at the start of a run or after loading a checkpoint
+void init_pattern_monitor(PatternMonitor& monitor, const std::vector<int>& compartments, const TissueGraph& tissue,
+                          double low_fraction);
+// Call after any rxn that changed cell_i's N
+void update_pattern_monitor(PatternMonitor& monitor, int cell_i, const std::vector<int>& compartments, const TissueGraph& tissue);
+
+// A run has converged once the order parameter has stayed within `tolerance` of
+// where it was `window` of simulated time ago (and the whole time in between)
+struct ConvergenceCriteria {
+    double tolerance;
+    double window;
+};
+
+// One cell flipping moves the order parameter by 1/num_cells, so a tolerance much
+// below that can never be met on a small tissue. The default allows a few cells'
+// worth of noise, and never less than 0.03
+double default_convergence_tolerance(int num_cells);
+
+// ENGINE =============================================================
+// Embeddable driver: step one rxn at a time or run to a simulated time, with
+// observers called after every rxn. The tissue's arrays must outlive the engine
+class DeltaNotchEngine
+{
+public:
+    using Observer = std::function<void(const SSAState&)>;
+
+    DeltaNotchEngine(TissueGraph tissue, SSAState state);
+
+    // Returns false once no rxns are left
+    bool step();
+    // Fires every rxn up to `time` and leaves time at `time`, so one call and many
+    // shorter calls to the same time give the same run. Returns early once the pattern has converged, if stop_on_convergence was called
+    void run_until(double time);
+    void add_observer(Observer observer);
+    // Save to `path` after every `every`th rxn from here on (none if every <= 0)
+    void save_checkpoint_every(const std::string& path, long long every);
+    // False once every propensity is 0, i.e. the run can't go any further
+    bool rxns_left() const { return m_propensities.total() > 0.0; }
+
+    // Make run_until stop once the pattern settles. The window starts over
+    // after load_checkpoint, since the monitor history isn't checkpointed
+    void stop_on_convergence(ConvergenceCriteria criteria);
+    bool converged() const { return m_converged; }
+    double order_parameter() const { return m_monitor.order_parameter(); }
+
+    const SSAState& state() const { return m_state; }
+    const TissueGraph& tissue() const { return m_tissue; }
+
+    bool save_checkpoint(const std::string& path) const;
+    bool load_checkpoint(const std::string& path);
+
+private:
+    TissueGraph m_tissue;
+    SSAState m_state;
+    PropensityTree m_propensities;
+    std::vector<Observer> m_observers;
+
+    // Keep the monitor current after a rxn and check it against m_criteria
+    void track_pattern(int fired_rxn);
+    void reset_convergence();
+
+    PatternMonitor m_monitor;
+    bool m_stops_on_convergence = false;
+    ConvergenceCriteria m_criteria = {0.0, 0.0};
+    double m_window_start_time = 0.0;
+    double m_window_order_parameter = 0.0;
+    bool m_converged = false;
+};
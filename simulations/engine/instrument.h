@@ -0,0 +1,251 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Hot-path instrumentation: scoped timers, counters and per-phase log2
+// histograms, recorded into per-thread buffers so recording never takes a lock.
+// Compile with -DSIM_INSTRUMENT to turn it on. Without it every macro expands
+// to nothing and the export functions are empty, so it can stay in the code.
+//
+//   INSTRUMENT_SCOPE("choose_a_rxn");      // times the rest of the enclosing block
+//   INSTRUMENT_COUNT("rxns fired", 1);     // adds to a named counter
+//   instrument::write_chrome_trace("trace.json");  // open in chrome://tracing or perfetto
+//   instrument::print_summary(std::cout);
+
+#ifdef SIM_INSTRUMENT
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace instrument {
+
+constexpr bool enabled = true;
+
+// Only the first MAX_TRACE_EVENTS per thread go into the trace; histograms keep counting after that
+const size_t MAX_TRACE_EVENTS = 1 << 20;
+const int NUM_HISTOGRAM_BUCKETS = 64; // bucket b holds durations in [2^(b-1), 2^b) ns
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+struct PhaseStats {
+    const char* name;
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t histogram[NUM_HISTOGRAM_BUCKETS] = {};
+};
+
+struct Counter {
+    const char* name;
+    int64_t value = 0;
+};
+
+struct ThreadBuffer {
+    int thread_id;
+    std::vector<TraceEvent> events;
+    // a handful of phases per engine, so a linear scan on the name pointer beats a map
+    std::vector<PhaseStats> phases;
+    std::vector<Counter> counters;
+};
+
+// Buffers are owned by the registry and outlive their threads so they can be exported at the end
+inline std::mutex registry_lock;
+inline std::vector<std::unique_ptr<ThreadBuffer>> registry;
+inline const auto epoch = std::chrono::steady_clock::now();
+
+inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+inline ThreadBuffer& thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registry_lock);
+        registry.push_back(std::make_unique<ThreadBuffer>());
+        buffer = registry.back().get();
+        buffer->thread_id = static_cast<int>(registry.size());
+        buffer->events.reserve(4096);
+    }
+    return *buffer;
+}
+
+template <typename T>
+T& find_or_add(std::vector<T>& items, const char* name) {
+    for (T& item : items) {
+        if (item.name == name) {
+            return item;
+        }
+    }
+    items.push_back(T());
+    items.back().name = name;
+    return items.back();
+}
+
+inline int histogram_bucket(uint64_t duration_ns) {
+    int bucket = 0;
+    while (duration_ns > 0 && bucket < NUM_HISTOGRAM_BUCKETS - 1) {
+        duration_ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+inline void record(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+    ThreadBuffer& buffer = thread_buffer();
+    if (buffer.events.size() < MAX_TRACE_EVENTS) {
+        buffer.events.push_back({name, start_ns, duration_ns});
+    }
+    PhaseStats& phase = find_or_add(buffer.phases, name);
+    ++phase.count;
+    phase.total_ns += duration_ns;
+    ++phase.histogram[histogram_bucket(duration_ns)];
+}
+
+inline void count(const char* name, int64_t amount) {
+    find_or_add(thread_buffer().counters, name).value += amount;
+}
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char* name) : m_name(name), m_start_ns(now_ns()) {}
+    ~ScopedTimer() { record(m_name, m_start_ns, now_ns() - m_start_ns); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start_ns;
+};
+
+// Merge every thread's stats by name (the same literal can have different addresses across files)
+inline std::vector<PhaseStats> merged_phases() {
+    std::vector<PhaseStats> merged;
+    for (const auto& buffer : registry) {
+        for (const PhaseStats& phase : buffer->phases) {
+            auto found = std::find_if(merged.begin(), merged.end(),
+                                      [&phase](const PhaseStats& m) { return strcmp(m.name, phase.name) == 0; });
+            if (found == merged.end()) {
+                merged.push_back(phase);
+                continue;
+            }
+            found->count += phase.count;
+            found->total_ns += phase.total_ns;
+            for (int b = 0; b < NUM_HISTOGRAM_BUCKETS; ++b) {
+                found->histogram[b] += phase.histogram[b];
+            }
+        }
+    }
+    return merged;
+}
+
+// Same for counters: one total per name over all threads
+inline std::vector<Counter> merged_counters() {
+    std::vector<Counter> merged;
+    for (const auto& buffer : registry) {
+        for (const Counter& counter : buffer->counters) {
+            auto found = std::find_if(merged.begin(), merged.end(),
+                                      [&counter](const Counter& m) { return strcmp(m.name, counter.name) == 0; });
+            if (found == merged.end()) {
+                merged.push_back(counter);
+                continue;
+            }
+            found->value += counter.value;
+        }
+    }
+    return merged;
+}
+
+// Upper edge of the histogram bucket containing the given quantile
+inline uint64_t histogram_quantile(const PhaseStats& phase, double quantile) {
+    uint64_t target = static_cast<uint64_t>(quantile * phase.count);
+    uint64_t seen = 0;
+    for (int b = 0; b < NUM_HISTOGRAM_BUCKETS; ++b) {
+        seen += phase.histogram[b];
+        if (seen > target) {
+            return b == 0 ? 0 : (uint64_t(1) << b);
+        }
+    }
+    return 0;
+}
+
+inline void print_summary(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    out << std::left << std::setw(28) << "phase" << std::right
+        << std::setw(12) << "calls" << std::setw(14) << "total ms"
+        << std::setw(12) << "mean ns" << std::setw(12) << "p50 ns<" << std::setw(12) << "p99 ns<" << "\n";
+    for (const PhaseStats& phase : merged_phases()) {
+        out << std::left << std::setw(28) << phase.name << std::right
+            << std::setw(12) << phase.count
+            << std::setw(14) << std::fixed << std::setprecision(3) << phase.total_ns / 1e6
+            << std::setw(12) << std::setprecision(0) << static_cast<double>(phase.total_ns) / std::max<uint64_t>(phase.count, 1)
+            << std::setw(12) << histogram_quantile(phase, 0.5)
+            << std::setw(12) << histogram_quantile(phase, 0.99) << "\n";
+    }
+    for (const Counter& counter : merged_counters()) {
+        out << std::left << std::setw(28) << counter.name << std::right << std::setw(12) << counter.value << "  (counter)\n";
+    }
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+}
+
+// Chrome trace event format: complete ("X") events with microsecond timestamps
+inline bool write_chrome_trace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not open " << path << " for writing." << std::endl;
+        return false;
+    }
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer : registry) {
+        for (const TraceEvent& event : buffer->events) {
+            out << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+                << ",\"ts\":" << event.start_ns / 1000.0 << ",\"dur\":" << event.duration_ns / 1000.0 << "}";
+            first = false;
+        }
+    }
+    // counter tracks belong to the process, so one event per name with the total
+    for (const Counter& counter : merged_counters()) {
+        out << (first ? "" : ",\n") << "{\"name\":\"" << counter.name << "\",\"ph\":\"C\",\"pid\":1"
+            << ",\"ts\":" << now_ns() / 1000.0 << ",\"args\":{\"value\":" << counter.value << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace instrument
+
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+#define INSTRUMENT_SCOPE(name) instrument::ScopedTimer INSTRUMENT_CONCAT(instrument_scope_, __LINE__)(name)
+#define INSTRUMENT_COUNT(name, amount) instrument::count(name, amount)
+
+#else
+
+namespace instrument {
+
+constexpr bool enabled = false;
+
+inline void print_summary(std::ostream&) {}
+inline bool write_chrome_trace(const std::string&) { return true; }
+
+} // namespace instrument
+
+#define INSTRUMENT_SCOPE(name) ((void)0)
+#define INSTRUMENT_COUNT(name, amount) ((void)0)
+
+#endif
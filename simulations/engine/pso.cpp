@@ -0,0 +1,783 @@
+#include "pso.h"
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <tuple>
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <array>
+#include <numeric>
+
+#include "checkpoint.h"
+#include "instrument.h"
+#include "work_stealing_pool.h"
+
+using namespace std;
+
+// Convergence, Separation, Alignment, Cohesion
+
+static double f(const vector<double>& position, const vector<double>& f_center) {
+    double x_shifted = position[0] - f_center[0];
+    double y_shifted = position[1] - f_center[1];
+    return x_shifted*x_shifted + y_shifted*y_shifted;
+}
+
+using ParticleState = tuple<vector<vector<double>>, vector<vector<double>>, vector<vector<double>>>;
+
+// Initialize the particles
+static ParticleState initialize_particles(int num_particles, mt19937& gen) {
+    uniform_real_distribution<double> initial_position_distribution(0.0, PSO_SPACE_WIDTH);
+    uniform_real_distribution<double> initial_velocity_distribution(-1.0, 1.0);
+
+    vector<vector<double>> particle_positions;
+    vector<vector<double>> particle_velocities;
+    vector<vector<double>> particle_best_positions;
+
+    for (int i = 0; i < num_particles; ++i) {
+        vector<double> position = {initial_position_distribution(gen), initial_position_distribution(gen)};  // Random initial position in the range [-10, 10]
+        particle_positions.push_back(position);
+
+        vector<double> velocity = {initial_velocity_distribution(gen), initial_velocity_distribution(gen)};  // Random initial velocity in the range [-1, 1]
+        particle_velocities.push_back(velocity);
+
+        particle_best_positions.push_back(position);
+    }
+
+    return make_tuple(particle_positions, particle_velocities, particle_best_positions);
+}
+
+// Helper function for infinite space and wrap around positions (in place)
+static void infinite_space(vector<double>& position, vector<double>& velocity) {
+    if (position[0] > PSO_SPACE_WIDTH)
+    {
+        position[0] = PSO_SPACE_WIDTH;
+        velocity[0] = 0;
+    } else if (position[0] < 0)
+    {
+        position[0] = 0;
+        velocity[0] = 0;
+    }
+    if (position[1] > PSO_SPACE_HEIGHT)
+    {
+        position[1] = PSO_SPACE_HEIGHT;
+        velocity[1] = 0;
+    } else if (position[1] < 0)
+    {
+        position[1] = 0;
+        velocity[1] = 0;
+    }
+}
+
+static double calculate_distance(const vector<double>& p1, const vector<double>& p2) {
+    double dx = p1[0] - p2[0];
+    double dy = p1[1] - p2[1];
+    return sqrt(dx*dx + dy*dy);
+}
+
+// For now, neighbor function is just all neighbors within a distance.
+// Returns the index of the neighbor with the best objective value (closest one on ties),
+// or -1 if there are no neighbors. Scans in place so the hot loop never allocates
+static int get_social_best_neighbor(const vector<double>& reference, const vector<vector<double>>& positions, int neighborhood_distance, const vector<double>& f_center) {
+    int best_neighbor = -1;
+    double best_value = 0.0;
+    double best_distance = 0.0;
+    int num_neighbors = 0;
+
+    for (size_t j = 0; j < positions.size(); ++j) {
+        double distance = calculate_distance(positions[j], reference);
+        if (distance <= neighborhood_distance && distance > 0) { // don't inlcude yourself
+            ++num_neighbors;
+            double value = f(positions[j], f_center);
+            if (best_neighbor == -1 || value < best_value || (value == best_value && distance < best_distance)) {
+                best_neighbor = static_cast<int>(j);
+                best_value = value;
+                best_distance = distance;
+            }
+        }
+    }
+    INSTRUMENT_COUNT("neighbours found", num_neighbors);
+
+    return best_neighbor;
+}
+
+// Helper function to adjust particle velocities to avoid collisions (in place)
+static void avoid_collisions(const vector<double>& position, vector<double>& velocity, int i, const vector<vector<double>>& particle_positions) {
+    for (size_t j = 0; j < particle_positions.size(); ++j) {
+        if (j != static_cast<size_t>(i)) {
+            double direction_x = particle_positions[j][0] - position[0];
+            double direction_y = particle_positions[j][1] - position[1];
+            double norm = sqrt(direction_x*direction_x + direction_y*direction_y);
+            direction_x /= norm;
+            direction_y /= norm;
+
+            velocity[0] -= (10/(norm*norm)) * direction_x;
+            velocity[1] -= (10/(norm*norm)) * direction_y;
+        }
+    }
+}
+
+static void scatter(const vector<double>& position, vector<double>& velocity, int i, const vector<vector<double>>& particle_positions) {
+    for (size_t j = 0; j < particle_positions.size(); ++j) {
+        if (j != static_cast<size_t>(i)) {
+            double direction_x = particle_positions[j][0] - position[0];
+            double direction_y = particle_positions[j][1] - position[1];
+            double norm = sqrt(direction_x*direction_x + direction_y*direction_y);
+            direction_x /= norm;
+            direction_y /= norm;
+
+            velocity[0] -= (100) * direction_x;
+            velocity[1] -= (100) * direction_y;
+        }
+    }
+}
+
+PSOState initialize_pso_state(int num_particles, mt19937 gen) {
+    // gen is advanced past the initial draws, otherwise the first f_center would
+    // land exactly on particle 0's starting position
+    ParticleState particles = initialize_particles(num_particles, gen);
+    return {get<0>(particles), get<1>(particles), get<2>(particles), {0.0, 0.0}, 0, gen};
+}
+
+void move_f_center(vector<double>& f_center, int iteration, mt19937& gen) {
+    uniform_real_distribution<double> U(0.0, 1.0);
+    if (iteration % 200 == 0) {
+        f_center[0] = U(gen) *PSO_SPACE_WIDTH;
+        f_center[1] = U(gen) *PSO_SPACE_HEIGHT;
+    }
+}
+
+// Works entirely in the state's existing arrays, so after the first call this never touches the heap
+void update_particles(PSOState& state, int neighborhood_distance, double c1, double c2, double w) {
+    double timestep = 0.001;
+    int iteration = state.iteration;
+    int num_particles = static_cast<int>(state.particle_positions.size());
+    vector<vector<double>>& particle_positions = state.particle_positions;
+    vector<double>& f_center = state.f_center;
+    mt19937& gen = state.gen;
+
+    // Random distribution for random weighting of cognitive vs social vs inertial
+    uniform_real_distribution<double> U(0.0, 1.0);
+
+    for (int i = 0; i < num_particles; ++i) {
+        vector<double>& position = particle_positions[i];
+        vector<double>& velocity = state.particle_velocities[i];
+        vector<double>& personal_best_position = state.particle_best_positions[i];
+
+        // 0. Find social influence group and social_best_position; update velocity
+        int social_best_neighbor;
+        {
+            INSTRUMENT_SCOPE("neighbour search");
+            social_best_neighbor = get_social_best_neighbor(position, particle_positions, neighborhood_distance, f_center);
+        }
+        {
+            INSTRUMENT_SCOPE("update");
+            if (social_best_neighbor == -1) {
+                // if no neighbors, don't just decrease velocity
+                double r1 = U(gen);
+                double r2 = U(gen);
+                velocity[0] = velocity[0] + c1 * r1 * (personal_best_position[0] - position[0]);
+                velocity[1] = velocity[1] + c1 * r1 * (personal_best_position[1] - position[1]);
+            } else {
+                const vector<double>& social_best_position = particle_positions[social_best_neighbor];
+
+                double r1 = U(gen);
+                double r2 = U(gen);
+
+                velocity[0] = w * velocity[0] + c1 * r1 * (personal_best_position[0] - position[0]) + c2 * r2 * (social_best_position[0] - position[0]);
+                velocity[1] = w * velocity[1] + c1 * r1 * (personal_best_position[1] - position[1]) + c2 * r2 * (social_best_position[1] - position[1]);
+            }
+        }
+
+        // 0.5 Consider collisions
+        {
+            INSTRUMENT_SCOPE("avoid_collisions");
+            if (iteration == 1000 || iteration == 500 || iteration == 1500) {
+                scatter(position, velocity, i, particle_positions);
+            } else {
+                avoid_collisions(position, velocity, i, particle_positions);
+            }
+        }
+
+        // 1. Update position
+        position[0] = position[0] + velocity[0]*timestep;
+        position[1] = position[1] + velocity[1]*timestep;
+        infinite_space(position, velocity);
+
+        // 2. Evaluate the objective function at the new position
+        double value = f(position, f_center);
+
+        // 3. Update personal best if needed
+        if (value < f(personal_best_position, f_center)) {
+            personal_best_position = position;
+        }
+    }
+
+    state.iteration = iteration + 1;
+}
+
+void pso_step(PSOState& state, int neighborhood_distance, double c1, double c2, double w) {
+    move_f_center(state.f_center, state.iteration, state.gen);
+    update_particles(state, neighborhood_distance, c1, c2, w);
+}
+
+// Flatten {x, y} pairs so they can be written as one array
+static vector<double> flatten_positions(const vector<vector<double>>& positions) {
+    vector<double> flat;
+    for (const auto& position : positions) {
+        flat.push_back(position[0]);
+        flat.push_back(position[1]);
+    }
+    return flat;
+}
+
+static vector<vector<double>> unflatten_positions(const vector<double>& flat) {
+    vector<vector<double>> positions;
+    for (size_t i = 0; i + 1 < flat.size(); i += 2) {
+        positions.push_back({flat[i], flat[i + 1]});
+    }
+    return positions;
+}
+
+// Checkpoint layout: "PSCK", version, iteration, f_center, positions, velocities, personal bests, rng state
+bool save_pso_checkpoint(const string& path, const PSOState& state) {
+    // write to a temporary file first so a crash mid-save never clobbers the last good checkpoint
+    string tmp_path = path + ".tmp";
+    ofstream out(tmp_path, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Could not open " << tmp_path << " for writing." << endl;
+        return false;
+    }
+    write_checkpoint_header(out, "PSCK");
+    write_pod(out, static_cast<int32_t>(state.iteration));
+    write_array(out, state.f_center);
+    write_array(out, flatten_positions(state.particle_positions));
+    write_array(out, flatten_positions(state.particle_velocities));
+    write_array(out, flatten_positions(state.particle_best_positions));
+    write_rng(out, state.gen);
+    out.close();
+    if (!out || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        cerr << "Could not write checkpoint " << path << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_pso_checkpoint(const string& path, PSOState& state) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        cerr << "Could not open " << path << "." << endl;
+        return false;
+    }
+    int32_t iteration;
+    vector<double> positions, velocities, best_positions;
+    if (!read_checkpoint_header(in, "PSCK")
+        || !read_pod(in, iteration)
+        || !read_array(in, state.f_center)
+        || !read_array(in, positions)
+        || !read_array(in, velocities)
+        || !read_array(in, best_positions)
+        || !read_rng(in, state.gen)
+        || state.f_center.size() != 2
+        || velocities.size() != positions.size()
+        || best_positions.size() != positions.size()) {
+        cerr << "Corrupt checkpoint " << path << "." << endl;
+        return false;
+    }
+    state.iteration = iteration;
+    state.particle_positions = unflatten_positions(positions);
+    state.particle_velocities = unflatten_positions(velocities);
+    state.particle_best_positions = unflatten_positions(best_positions);
+    return true;
+}
+
+// Run PSO simulation from `state` (fresh or restored from a checkpoint) until max_iterations.
+// If `checkpoint_path` is set, the state is saved every `checkpoint_every` iterations and at the end
+pair<vector<vector<vector<double>>>, vector<vector<double>>> run_pso(PSOState state, int max_iterations, int neighborhood_distance, double c1, double c2, double w, string checkpoint_path, int checkpoint_every) {
+    vector<vector<vector<double>>> particles_history;
+    vector<vector<double>> f_center_history;
+
+    PSOConfig config = {c1, c2, w, neighborhood_distance, static_cast<int>(state.particle_positions.size())};
+    PSOEngine engine(config, state);
+    engine.add_observer([&particles_history, &f_center_history](const PSOState& state) {
+        INSTRUMENT_SCOPE("history append");
+        particles_history.push_back(state.particle_positions);
+        f_center_history.push_back(state.f_center);
+    });
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint_every(checkpoint_path, checkpoint_every);
+    }
+
+    // PSO optimization loop
+    engine.run_until(max_iterations);
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint(checkpoint_path);
+    }
+
+    return make_pair(particles_history, f_center_history);
+}
+
+pair<vector<vector<vector<double>>>, vector<vector<double>>> run_pso(int num_particles, int max_iterations, int neighborhood_distance, double c1, double c2, double w, mt19937 gen) {
+    // Initialize the global best-known position and value
+    PSOState state = initialize_pso_state(num_particles, gen);
+    return run_pso(state, max_iterations, neighborhood_distance, c1, c2, w, "", 0);
+}
+
+// HYPERPARAMETER SWEEPS =============================================================
+// Spec file is one `key = values...` per line, # starts a comment. e.g.
+//   c1 = 1.0 1.5 2.0        (grid over these values)
+//   w = uniform 0.4 0.95    (random search, needs `samples = <n>`)
+//   replicates = 5
+// Recognized params: c1 c2 w neighborhood_distance num_particles;
+// settings: replicates samples max_iterations tolerance seed
+// Helper function to read one number that has to fill the whole token, so `abc` or `1.5x` is an error
+template <typename T>
+static bool parse_sweep_value(const string& token, T& value) {
+    istringstream in(token);
+    char extra;
+    return static_cast<bool>(in >> value) && !(in >> extra);
+}
+
+bool parse_sweep_spec(const string& path, SweepSpec& spec) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "Could not open sweep spec " << path << "." << endl;
+        return false;
+    }
+    string line;
+    int line_number = 0;
+    while (getline(in, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+        size_t equals = line.find('=');
+        if (equals == string::npos) {
+            if (line.find_first_not_of(" \t\r") != string::npos) {
+                cerr << path << ":" << line_number << ": expected `key = values`." << endl;
+                return false;
+            }
+            continue;
+        }
+        string key;
+        istringstream(line.substr(0, equals)) >> key;
+        istringstream values_in(line.substr(equals + 1));
+        vector<string> values;
+        string token;
+        while (values_in >> token) {
+            values.push_back(token);
+        }
+
+        bool is_valid = !values.empty();
+        if (key == "replicates" || key == "samples" || key == "max_iterations" || key == "tolerance" || key == "seed") {
+            is_valid = is_valid && values.size() == 1;
+            if (key == "replicates") {
+                is_valid = is_valid && parse_sweep_value(values[0], spec.replicates);
+            } else if (key == "samples") {
+                is_valid = is_valid && parse_sweep_value(values[0], spec.samples);
+            } else if (key == "max_iterations") {
+                is_valid = is_valid && parse_sweep_value(values[0], spec.max_iterations);
+            } else if (key == "tolerance") {
+                is_valid = is_valid && parse_sweep_value(values[0], spec.tolerance);
+            } else {
+                is_valid = is_valid && parse_sweep_value(values[0], spec.seed);
+            }
+        } else if (key == "c1" || key == "c2" || key == "w" || key == "neighborhood_distance" || key == "num_particles") {
+            SweepParam param;
+            if (is_valid && values[0] == "uniform") {
+                param.is_uniform = true;
+                is_valid = values.size() == 3 && parse_sweep_value(values[1], param.lo) && parse_sweep_value(values[2], param.hi);
+            } else {
+                for (const string& value_token : values) {
+                    double value;
+                    is_valid = is_valid && parse_sweep_value(value_token, value);
+                    param.values.push_back(value);
+                }
+            }
+            // a uniform param can land anywhere between its bounds, so the smaller bound is what counts
+            double lowest = 0.0;
+            if (is_valid) {
+                lowest = param.is_uniform ? min(param.lo, param.hi) : *min_element(param.values.begin(), param.values.end());
+            }
+            if (is_valid && key == "num_particles" && lround(lowest) < 1) {
+                cerr << path << ":" << line_number << ": `num_particles` has to be at least 1." << endl;
+                return false;
+            }
+            if (is_valid && key == "neighborhood_distance" && lround(lowest) < 0) {
+                cerr << path << ":" << line_number << ": `neighborhood_distance` can't be negative." << endl;
+                return false;
+            }
+            spec.params[key] = param;
+        } else {
+            cerr << path << ":" << line_number << ": unknown key `" << key << "`." << endl;
+            return false;
+        }
+        if (!is_valid) {
+            cerr << path << ":" << line_number << ": bad value for `" << key << "`." << endl;
+            return false;
+        }
+        if (key == "replicates" && spec.replicates < 1) {
+            cerr << path << ":" << line_number << ": `replicates` has to be at least 1." << endl;
+            return false;
+        }
+        if (key == "max_iterations" && spec.max_iterations < 0) {
+            cerr << path << ":" << line_number << ": `max_iterations` can't be negative." << endl;
+            return false;
+        }
+    }
+
+    // a random search runs `samples` configs, so without any it would run nothing
+    for (const auto& [name, param] : spec.params) {
+        if (param.is_uniform && spec.samples <= 0) {
+            cerr << path << ": `" << name << "` is uniform, which needs `samples = <n>` with n > 0." << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Turn the spec into concrete configs, either the full grid or `samples` random draws.
+// Params not mentioned in the spec keep their value from `defaults`
+vector<PSOConfig> expand_sweep(const SweepSpec& spec, PSOConfig defaults) {
+    vector<string> names = {"c1", "c2", "w", "neighborhood_distance", "num_particles"};
+    auto set_param = [](PSOConfig& config, const string& name, double value) {
+        if (name == "c1") config.c1 = value;
+        else if (name == "c2") config.c2 = value;
+        else if (name == "w") config.w = value;
+        else if (name == "neighborhood_distance") config.neighborhood_distance = static_cast<int>(lround(value));
+        else if (name == "num_particles") config.num_particles = static_cast<int>(lround(value));
+    };
+
+    bool is_random_search = false;
+    for (const auto& [name, param] : spec.params) {
+        is_random_search = is_random_search || param.is_uniform;
+    }
+
+    vector<PSOConfig> configs;
+    if (is_random_search) {
+        mt19937 gen(spec.seed);
+        uniform_real_distribution<double> U(0.0, 1.0);
+        for (int sample = 0; sample < spec.samples; ++sample) {
+            PSOConfig config = defaults;
+            for (const string& name : names) {
+                auto found = spec.params.find(name);
+                if (found == spec.params.end()) {
+                    continue;
+                }
+                const SweepParam& param = found->second;
+                if (param.is_uniform) {
+                    set_param(config, name, param.lo + U(gen) * (param.hi - param.lo));
+                } else {
+                    set_param(config, name, param.values[static_cast<size_t>(U(gen) * param.values.size()) % param.values.size()]);
+                }
+            }
+            configs.push_back(config);
+        }
+    } else {
+        configs.push_back(defaults);
+        for (const string& name : names) {
+            auto found = spec.params.find(name);
+            if (found == spec.params.end()) {
+                continue;
+            }
+            vector<PSOConfig> expanded;
+            for (const PSOConfig& config : configs) {
+                for (double value : found->second.values) {
+                    PSOConfig new_config = config;
+                    set_param(new_config, name, value);
+                    expanded.push_back(new_config);
+                }
+            }
+            configs = expanded;
+        }
+    }
+    return configs;
+}
+
+double swarm_error(const PSOState& state) {
+    double best_value = f(state.particle_positions[0], state.f_center);
+    for (const auto& position : state.particle_positions) {
+        best_value = min(best_value, f(position, state.f_center));
+    }
+    return best_value;
+}
+
+// Like run_pso, but only keeps the summary numbers instead of the whole history
+SweepResult run_sweep_job(PSOConfig config, int replicate, unsigned seed, int max_iterations, double tolerance) {
+    auto start = chrono::steady_clock::now();
+
+    PSOState state = initialize_pso_state(config.num_particles, mt19937(seed));
+    int iterations_to_tolerance = -1;
+    while (state.iteration < max_iterations) {
+        pso_step(state, config.neighborhood_distance, config.c1, config.c2, config.w);
+        if (iterations_to_tolerance < 0 && swarm_error(state) <= tolerance) {
+            iterations_to_tolerance = state.iteration;
+        }
+    }
+
+    double wall_time_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return {config, replicate, seed, swarm_error(state), iterations_to_tolerance, wall_time_ms};
+}
+
+// Run every config x replicate on a work-stealing pool and write one csv row per run
+bool run_sweep(const SweepSpec& spec, PSOConfig defaults, const string& out_path, int num_threads) {
+    vector<PSOConfig> configs = expand_sweep(spec, defaults);
+    size_t num_jobs = configs.size() * spec.replicates;
+    vector<SweepResult> results(num_jobs); // each job writes only its own slot
+    cout << "sweeping " << configs.size() << " configs x " << spec.replicates << " replicates on " << num_threads << " threads..." << endl;
+
+    auto start = chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(num_threads);
+        for (size_t config_i = 0; config_i < configs.size(); ++config_i) {
+            for (int replicate = 0; replicate < spec.replicates; ++replicate) {
+                size_t job_i = config_i * spec.replicates + replicate;
+                unsigned seed = spec.seed + static_cast<unsigned>(job_i);
+                PSOConfig config = configs[config_i];
+                int max_iterations = spec.max_iterations;
+                double tolerance = spec.tolerance;
+                pool.submit([&results, job_i, config, replicate, seed, max_iterations, tolerance] {
+                    results[job_i] = run_sweep_job(config, replicate, seed, max_iterations, tolerance);
+                });
+            }
+        }
+        pool.wait();
+    }
+    double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "sweep done in " << total_s << " s" << endl;
+
+    ofstream out(out_path);
+    if (!out) {
+        cerr << "Could not open " << out_path << " for writing." << endl;
+        return false;
+    }
+    out << "c1,c2,w,neighborhood_distance,num_particles,replicate,seed,final_error,iterations_to_tolerance,wall_time_ms\n";
+    for (const SweepResult& result : results) {
+        out << result.config.c1 << ',' << result.config.c2 << ',' << result.config.w << ','
+            << result.config.neighborhood_distance << ',' << result.config.num_particles << ','
+            << result.replicate << ',' << result.seed << ',' << result.final_error << ','
+            << result.iterations_to_tolerance << ',' << result.wall_time_ms << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+// ISLAND MODEL =============================================================
+// Several sub-swarms run on their own threads and every `migrate_every` iterations
+// swap their best particles with the islands next to them in the migration topology.
+// Islands never wait on each other: migrants go through lock-free mailboxes and an
+// island just takes whatever its neighbors most recently published.
+
+const int MAX_MIGRANTS = 8;
+// Mixed into the objective rng's seed so it never matches an island's particle rng
+const unsigned OBJECTIVE_SEED_STREAM = 0xF;
+
+// One writer (the owning island), any number of readers. Seqlock: the sequence is
+// odd while the writer is mid-update, and a reader keeps what it read only if the
+// sequence was even and unchanged around the read. alignas keeps islands off each
+// other's cache lines
+namespace {
+struct alignas(64) MigrantMailbox {
+    atomic<uint64_t> sequence{0};
+    atomic<int> num_migrants{0};
+    array<atomic<double>, 2 * MAX_MIGRANTS> positions;
+};
+} // namespace
+
+static void publish_migrants(MigrantMailbox& mailbox, const vector<vector<double>>& migrants, int num_migrants) {
+    uint64_t sequence = mailbox.sequence.load(memory_order_relaxed);
+    mailbox.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    mailbox.num_migrants.store(num_migrants, memory_order_relaxed);
+    for (int m = 0; m < num_migrants; ++m) {
+        mailbox.positions[2 * m].store(migrants[m][0], memory_order_relaxed);
+        mailbox.positions[2 * m + 1].store(migrants[m][1], memory_order_relaxed);
+    }
+    mailbox.sequence.store(sequence + 2, memory_order_release);
+}
+
+// Returns the number of migrants read, or 0 if there is nothing new since
+// `last_sequence` (or the writer was mid-update, in which case try again next time)
+static int read_migrants(const MigrantMailbox& mailbox, uint64_t& last_sequence, vector<vector<double>>& migrants) {
+    uint64_t sequence_before = mailbox.sequence.load(memory_order_acquire);
+    if (sequence_before % 2 == 1 || sequence_before == last_sequence) {
+        return 0;
+    }
+    int num_migrants = min(mailbox.num_migrants.load(memory_order_relaxed), MAX_MIGRANTS);
+    for (int m = 0; m < num_migrants; ++m) {
+        migrants[m][0] = mailbox.positions[2 * m].load(memory_order_relaxed);
+        migrants[m][1] = mailbox.positions[2 * m + 1].load(memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (mailbox.sequence.load(memory_order_relaxed) != sequence_before) {
+        return 0;
+    }
+    last_sequence = sequence_before;
+    return num_migrants;
+}
+
+// Which islands send to `island_i`
+static vector<int> migration_sources(int island_i, int num_islands, MigrationTopology topology) {
+    vector<int> sources;
+    if (num_islands < 2) {
+        return sources;
+    }
+    if (topology == MigrationTopology::ring) {
+        sources.push_back((island_i + num_islands - 1) % num_islands);
+    } else {
+        for (int other = 0; other < num_islands; ++other) {
+            if (other != island_i) {
+                sources.push_back(other);
+            }
+        }
+    }
+    return sources;
+}
+
+static void run_island(int island_i, int num_islands, PSOConfig config, int max_iterations, int migrate_every, int num_migrants,
+                MigrationTopology topology, unsigned seed, vector<MigrantMailbox>& mailboxes, IslandResult& result) {
+    PSOState state = initialize_pso_state(config.num_particles, mt19937(seed + island_i));
+    // every island draws the same sequence of f_centers from its own copy of the objective rng,
+    // so they all chase the same objective without sharing anything. Its own seed stream,
+    // since seed + 0 would put island 0's first f_center right on its particle 0
+    seed_seq objective_seed{seed, OBJECTIVE_SEED_STREAM};
+    mt19937 objective_gen(objective_seed);
+
+    num_migrants = max(0, min({num_migrants, MAX_MIGRANTS, config.num_particles}));
+    vector<int> sources = migration_sources(island_i, num_islands, topology);
+    vector<uint64_t> last_sequences(sources.size(), 0);
+    vector<vector<double>> migrants(MAX_MIGRANTS, vector<double>(2));
+    vector<int> ranked(config.num_particles); // particle indices, best personal best first
+    result.migrants_received = 0;
+
+    auto personal_best_value = [&state](int i) { return f(state.particle_best_positions[i], state.f_center); };
+
+    while (state.iteration < max_iterations) {
+        move_f_center(state.f_center, state.iteration, objective_gen);
+        update_particles(state, config.neighborhood_distance, config.c1, config.c2, config.w);
+
+        if (migrate_every <= 0 || state.iteration % migrate_every != 0 || sources.empty() || num_migrants == 0) {
+            continue;
+        }
+        iota(ranked.begin(), ranked.end(), 0);
+        sort(ranked.begin(), ranked.end(), [&personal_best_value](int a, int b) { return personal_best_value(a) < personal_best_value(b); });
+
+        // emigrate: best personal bests go out
+        for (int m = 0; m < num_migrants; ++m) {
+            migrants[m] = state.particle_best_positions[ranked[m]];
+        }
+        publish_migrants(mailboxes[island_i], migrants, num_migrants);
+
+        // immigrate: newcomers replace the worst particles, one source after another
+        int worst = config.num_particles - 1;
+        for (size_t source_i = 0; source_i < sources.size(); ++source_i) {
+            int num_read = read_migrants(mailboxes[sources[source_i]], last_sequences[source_i], migrants);
+            for (int m = 0; m < num_read && worst >= num_migrants; ++m) {
+                // the same personal best keeps getting re-sent until it improves, and two particles
+                // on the exact same spot would blow up avoid_collisions, so skip ones already here
+                bool already_here = false;
+                for (int i = 0; i < config.num_particles; ++i) {
+                    already_here = already_here || state.particle_best_positions[i] == migrants[m] || state.particle_positions[i] == migrants[m];
+                }
+                if (already_here) {
+                    continue;
+                }
+                int replaced = ranked[worst--];
+                state.particle_positions[replaced] = migrants[m];
+                state.particle_best_positions[replaced] = migrants[m];
+                ++result.migrants_received;
+            }
+        }
+    }
+
+    result.final_error = swarm_error(state);
+    result.best_personal_error = personal_best_value(0);
+    for (int i = 1; i < config.num_particles; ++i) {
+        result.best_personal_error = min(result.best_personal_error, personal_best_value(i));
+    }
+}
+
+// Run `num_islands` sub-swarms of config.num_particles each, one thread per island
+vector<IslandResult> run_islands(int num_islands, PSOConfig config, int max_iterations, int migrate_every, int num_migrants,
+                                 MigrationTopology topology, unsigned seed) {
+    vector<MigrantMailbox> mailboxes(num_islands);
+    vector<IslandResult> results(num_islands);
+    vector<thread> islands;
+    for (int island_i = 0; island_i < num_islands; ++island_i) {
+        islands.emplace_back(run_island, island_i, num_islands, config, max_iterations, migrate_every, num_migrants,
+                             topology, seed, ref(mailboxes), ref(results[island_i]));
+    }
+    for (thread& island : islands) {
+        island.join();
+    }
+    return results;
+}
+
+// ENGINE =============================================================
+PSOEngine::PSOEngine(PSOConfig config, mt19937 gen)
+    : m_config(config), m_state(initialize_pso_state(config.num_particles, gen))
+{
+}
+
+PSOEngine::PSOEngine(PSOConfig config, PSOState state)
+    : m_config(config), m_state(state)
+{
+}
+
+void PSOEngine::step()
+{
+    pso_step(m_state, m_config.neighborhood_distance, m_config.c1, m_config.c2, m_config.w);
+    for (const Observer& observer : m_observers) {
+        observer(m_state);
+    }
+}
+
+void PSOEngine::run_until(int iteration)
+{
+    while (m_state.iteration < iteration) {
+        step();
+    }
+}
+
+void PSOEngine::add_observer(Observer observer)
+{
+    m_observers.push_back(observer);
+}
+
+void PSOEngine::save_checkpoint_every(const string& path, int every)
+{
+    if (every <= 0) {
+        return;
+    }
+    add_observer([path, every](const PSOState& state) {
+        if (state.iteration % every == 0) {
+            save_pso_checkpoint(path, state);
+        }
+    });
+}
+
+bool PSOEngine::save_checkpoint(const string& path) const
+{
+    return save_pso_checkpoint(path, m_state);
+}
+
+bool PSOEngine::load_checkpoint(const string& path)
+{
+    PSOState state = m_state;
+    if (!load_pso_checkpoint(path, state)) {
+        return false;
+    }
+    if (static_cast<int>(state.particle_positions.size()) != m_config.num_particles) {
+        cerr << "Checkpoint has " << state.particle_positions.size() << " particles, expected " << m_config.num_particles << "." << endl;
+        return false;
+    }
+    m_state = state;
+    return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Particle swarm chasing a moving objective f (squared distance to f_center)
+// in a PSO_SPACE_WIDTH x PSO_SPACE_HEIGHT box. No SDL in here; the viewer maps
+// the box onto its window.
+
+const double PSO_SPACE_WIDTH = 100.0;
+const double PSO_SPACE_HEIGHT = 100.0;
+
+// Everything needed to pick a pso run back up exactly where it left off
+struct PSOState {
+    std::vector<std::vector<double>> particle_positions;
+    std::vector<std::vector<double>> particle_velocities;
+    std::vector<std::vector<double>> particle_best_positions;
+    std::vector<double> f_center;
+    int iteration;
+    std::mt19937 gen;
+};
+
+// Everything run_pso needs except the rng
+struct PSOConfig {
+    double c1; // Cognitive parameter
+    double c2; // Social parameter
+    double w;  // Inertia weight
+    int neighborhood_distance;
+    int num_particles;
+};
+
+// What the viewer runs with
+const PSOConfig DEFAULT_PSO_CONFIG = {1.5, 1.5, 0.9, 20, 30};
+
+PSOState initialize_pso_state(int num_particles, std::mt19937 gen);
+
+// The objective jumps to a new random spot every 200 iterations
+void move_f_center(std::vector<double>& f_center, int iteration, std::mt19937& gen);
+
+// Advance every particle by one iteration against the current f_center; never allocates after the first call
+void update_particles(PSOState& state, int neighborhood_distance, double c1, double c2, double w);
+
+// move_f_center + update_particles
+void pso_step(PSOState& state, int neighborhood_distance, double c1, double c2, double w);
+
+// Objective value of the best particle in the swarm right now
+double swarm_error(const PSOState& state);
+
+bool save_pso_checkpoint(const std::string& path, const PSOState& state);
+bool load_pso_checkpoint(const std::string& path, PSOState& state);
+
+// Full history runs: positions of every particle and f_center after every iteration
+std::pair<std::vector<std::vector<std::vector<double>>>, std::vector<std::vector<double>>> run_pso(PSOState state, int max_iterations, int neighborhood_distance, double c1, double c2, double w, std::string checkpoint_path, int checkpoint_every);
+std::pair<std::vector<std::vector<std::vector<double>>>, std::vector<std::vector<double>>> run_pso(int num_particles, int max_iterations, int neighborhood_distance, double c1, double c2, double w, std::mt19937 gen);
+
+// HYPERPARAMETER SWEEPS =============================================================
+// A swept parameter is either a list of values (grid) or a uniform range (random search)
+struct SweepParam {
+    std::vector<double> values;
+    bool is_uniform = false;
+    double lo = 0.0;
+    double hi = 0.0;
+};
+
+struct SweepSpec {
+    std::map<std::string, SweepParam> params;
+    int replicates = 1;
+    int samples = 0; // number of random-search configs, only used if some param is uniform
+    int max_iterations = 2000;
+    double tolerance = 1.0;
+    unsigned seed = 314;
+};
+
+struct SweepResult {
+    PSOConfig config;
+    int replicate;
+    unsigned seed;
+    double final_error;
+    int iterations_to_tolerance; // -1 if the swarm never got within tolerance
+    double wall_time_ms;
+};
+
+bool parse_sweep_spec(const std::string& path, SweepSpec& spec);
+std::vector<PSOConfig> expand_sweep(const SweepSpec& spec, PSOConfig defaults);
+SweepResult run_sweep_job(PSOConfig config, int replicate, unsigned seed, int max_iterations, double tolerance);
+bool run_sweep(const SweepSpec& spec, PSOConfig defaults, const std::string& out_path, int num_threads);
+
+// ISLAND MODEL =============================================================
+enum class MigrationTopology { ring, full };
+
+struct IslandResult {
+    double final_error;
+    double best_personal_error; // best personal best on the final objective
+    int migrants_received;
+};
+
+std::vector<IslandResult> run_islands(int num_islands, PSOConfig config, int max_iterations, int migrate_every, int num_migrants,
+                                      MigrationTopology topology, unsigned seed);
+
+// ENGINE =============================================================
+// Embeddable driver: step one iteration at a time or run to an iteration count,
+// with observers called after every iteration (e.g. to record or render frames)
+class PSOEngine
+{
+public:
+    using Observer = std::function<void(const PSOState&)>;
+
+    PSOEngine(PSOConfig config, std::mt19937 gen);
+    PSOEngine(PSOConfig config, PSOState state);
+
+    void step();
+    void run_until(int iteration);
+    void add_observer(Observer observer);
+    // Save to `path` after every `every`th iteration (none if every <= 0)
+    void save_checkpoint_every(const std::string& path, int every);
+
+    const PSOState& state() const { return m_state; }
+    const PSOConfig& config() const { return m_config; }
+
+    bool save_checkpoint(const std::string& path) const;
+    bool load_checkpoint(const std::string& path);
+
+private:
+    PSOConfig m_config;
+    PSOState m_state;
+    std::vector<Observer> m_observers;
+};
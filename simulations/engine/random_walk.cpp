@@ -0,0 +1,115 @@
+#include "random_walk.h"
+
+#include <cmath>
+
+using namespace std;
+
+void random_walk_step(RandomWalkState& state, int max_x, int max_y) {
+    uniform_int_distribution<int> U(0,4);
+    int direction = U(state.gen);
+    switch(direction)
+    {
+        case 0:
+            state.x += 1;
+            break;
+        case 1:
+            state.x -= 1;
+            break;
+        case 2:
+            state.y += 1;
+            break;
+        case 3:
+            state.y -= 1;
+            break;
+    }
+    // Infinite space
+    if (state.x > max_x)
+    {
+        state.x = 0;
+    } else if (state.x < 0)
+    {
+        state.x = max_x;
+    }
+
+    if (state.y > max_y)
+    {
+        state.y = 0;
+    } else if (state.y < 0)
+    {
+        state.y = max_y;
+    }
+    ++state.steps;
+}
+
+// Helper function to wrap a position plus displacement around a lattice of `size` sites,
+// same as random_walk_step's wrap-around but for any displacement
+static int wrap_position(int position, long long displacement, int size) {
+    long long wrapped = (position + (displacement % size)) % size;
+    return static_cast<int>(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+// Each step is one of the 5 cases of random_walk_step's switch, all with probability 1/5,
+// so the move counts (n0 n1 n2 n3 n_stay) after n steps are multinomial(n, 1/5 each) and
+// dx = n0 - n1, dy = n2 - n3.
+// Small n: exact, as a chain of binomials (n0 of n with 1/5, n1 of the rest with 1/4, ...).
+// Large n: dx and dy each have mean 0 and variance 2n/5 and are uncorrelated
+// (cov = n(-p0p2 + p0p3 + p1p2 - p1p3) = 0), so draw them as rounded normals
+void random_walk_jump(RandomWalkState& state, long long n, int max_x, int max_y) {
+    if (n <= 0) {
+        return;
+    }
+    long long dx;
+    long long dy;
+    if (n < JUMP_NORMAL_MIN_STEPS) {
+        long long move_counts[4];
+        long long left = n;
+        double move_probabilities[4] = {1.0 / 5.0, 1.0 / 4.0, 1.0 / 3.0, 1.0 / 2.0};
+        for (int move = 0; move < 4; ++move) {
+            binomial_distribution<long long> binomial(left, move_probabilities[move]);
+            move_counts[move] = binomial(state.gen);
+            left -= move_counts[move];
+        }
+        dx = move_counts[0] - move_counts[1];
+        dy = move_counts[2] - move_counts[3];
+    } else {
+        normal_distribution<double> normal(0.0, sqrt(0.4 * static_cast<double>(n)));
+        dx = llround(normal(state.gen));
+        dy = llround(normal(state.gen));
+    }
+    state.x = wrap_position(state.x, dx, max_x + 1);
+    state.y = wrap_position(state.y, dy, max_y + 1);
+    state.steps += n;
+}
+
+RandomWalkEngine::RandomWalkEngine(int max_x, int max_y, mt19937 gen)
+    : m_max_x(max_x), m_max_y(max_y), m_state{max_x / 2, max_y / 2, 0, gen}
+{
+}
+
+void RandomWalkEngine::step()
+{
+    random_walk_step(m_state, m_max_x, m_max_y);
+    for (const Observer& observer : m_observers) {
+        observer(m_state);
+    }
+}
+
+void RandomWalkEngine::jump(long long n)
+{
+    random_walk_jump(m_state, n, m_max_x, m_max_y);
+    for (const Observer& observer : m_observers) {
+        observer(m_state);
+    }
+}
+
+void RandomWalkEngine::run_until(long long steps)
+{
+    while (m_state.steps < steps) {
+        step();
+    }
+}
+
+void RandomWalkEngine::add_observer(Observer observer)
+{
+    m_observers.push_back(observer);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <random>
+#include <vector>
+
+// Lattice random walk: every step moves one site in x or y, or stays put
+// (5 equally likely choices), wrapping around a (max_x + 1) x (max_y + 1) lattice
+
+struct RandomWalkState {
+    int x;
+    int y;
+    long long steps;
+    std::mt19937 gen;
+};
+
+void random_walk_step(RandomWalkState& state, int max_x, int max_y);
+
+// Below this many steps a jump draws the exact multinomial, from here on the normal
+// limit. The normal's total variation distance from the exact displacement is about
+// 0.035/n per axis (so < 4e-6 here), and the wrapped position is even closer
+const long long JUMP_NORMAL_MIN_STEPS = 10000;
+
+// Where the walker is after n more steps, in O(1) whatever n is: draws the net
+// displacement directly instead of stepping, then wraps it around the lattice
+void random_walk_jump(RandomWalkState& state, long long n, int max_x, int max_y);
+
+// Embeddable driver: step once or run to a step count, with observers called after every step
+class RandomWalkEngine
+{
+public:
+    using Observer = std::function<void(const RandomWalkState&)>;
+
+    // Walker starts in the middle of the lattice
+    RandomWalkEngine(int max_x, int max_y, std::mt19937 gen);
+
+    void step();
+    // n steps at once via random_walk_jump; observers are called once, after the jump
+    void jump(long long n);
+    void run_until(long long steps);
+    void add_observer(Observer observer);
+
+    const RandomWalkState& state() const { return m_state; }
+    int max_x() const { return m_max_x; }
+    int max_y() const { return m_max_y; }
+
+private:
+    int m_max_x;
+    int m_max_y;
+    RandomWalkState m_state;
+    std::vector<Observer> m_observers;
+};
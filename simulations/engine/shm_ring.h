@@ -0,0 +1,295 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Live frames of a running simulation in POSIX shared memory, so a viewer in another
+// process can watch a headless run. The simulation writes each frame straight into
+// the next slot of a small ring and a viewer maps the ring read-only and renders
+// straight out of it: no copies on either side, no locks, and the simulation never
+// waits on the viewer.
+//
+// Every slot is a seqlock: its sequence is odd while the frame is being written.
+// A reader notes the (even) sequence, reads, and keeps what it read only if the
+// sequence hasn't moved since. `latest` names the newest committed frame, so with a
+// few slots the writer has to lap the ring before it touches a frame a reader is
+// still on.
+//
+// Layout (native byte order):
+//   ShmRingHeader
+//   num_slots x { ShmSlotHeader, float values[max_values] }, each padded to 64 bytes
+
+const uint32_t SHM_RING_VERSION = 1;
+
+// What the values of a frame mean:
+//   pso:         f_center x y, then x y of every particle (in the PSO_SPACE box)
+//   delta_notch: N D Z of every cell; width x height is the hex grid, 0 x 0 for a tissue file
+//   random_walk: walker x y, then the visit count of every site of the width x height lattice
+enum class ShmFrameKind : uint32_t { pso = 1, delta_notch = 2, random_walk = 3 };
+
+struct ShmRingHeader {
+    char magic[4]; // "SHMR", written last so a reader never sees a half set up ring
+    uint32_t version;
+    uint32_t kind;
+    uint32_t num_slots;
+    uint32_t width;
+    uint32_t height;
+    uint64_t max_values;
+    uint64_t slot_bytes;
+    std::atomic<uint64_t> latest; // frame number of the newest committed frame, 0 for none yet
+};
+
+struct ShmSlotHeader {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> frame_number;
+    std::atomic<uint64_t> num_values;
+    std::atomic<double> time;
+};
+
+// Mapped from another process, so they have to be address-free
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<double>::is_always_lock_free
+              && std::atomic<float>::is_always_lock_free, "shm ring needs lock-free atomics");
+static_assert(sizeof(ShmSlotHeader) % alignof(std::atomic<float>) == 0, "values follow the slot header");
+
+inline uint64_t shm_ring_slot_bytes(uint64_t max_values) {
+    uint64_t bytes = sizeof(ShmSlotHeader) + max_values * sizeof(std::atomic<float>);
+    return (bytes + 63) / 64 * 64;
+}
+
+inline ShmSlotHeader* shm_ring_slot(const ShmRingHeader* header, uint64_t slot_i) {
+    const char* first_slot = reinterpret_cast<const char*>(header) + (sizeof(ShmRingHeader) + 63) / 64 * 64;
+    return reinterpret_cast<ShmSlotHeader*>(const_cast<char*>(first_slot) + slot_i * header->slot_bytes);
+}
+
+inline std::atomic<float>* shm_ring_values(ShmSlotHeader* slot) {
+    return reinterpret_cast<std::atomic<float>*>(slot + 1);
+}
+
+// Writer side, owned by the simulation. Creates the shared memory object and unlinks
+// it again on close; a viewer that still has it mapped keeps its last frames
+class ShmPublisher
+{
+public:
+    ShmPublisher() = default;
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+    ~ShmPublisher() { close(); }
+
+    // `name` is a POSIX shm name like "/sim_pso"
+    bool open(const std::string& name, ShmFrameKind kind, uint32_t width, uint32_t height, uint64_t max_values,
+              uint32_t num_slots = 4) {
+        close();
+        uint64_t slot_bytes = shm_ring_slot_bytes(max_values);
+        m_size = (sizeof(ShmRingHeader) + 63) / 64 * 64 + num_slots * slot_bytes;
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cerr << "Could not create shared memory " << name << "." << std::endl;
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+            std::cerr << "Could not size shared memory " << name << "." << std::endl;
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        void* mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps the object alive
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Could not map shared memory " << name << "." << std::endl;
+            shm_unlink(name.c_str());
+            return false;
+        }
+        m_name = name;
+
+        // ftruncate zero-fills, so every sequence starts even and latest starts at 0
+        m_header = new (mapping) ShmRingHeader;
+        m_header->version = SHM_RING_VERSION;
+        m_header->kind = static_cast<uint32_t>(kind);
+        m_header->num_slots = num_slots;
+        m_header->width = width;
+        m_header->height = height;
+        m_header->max_values = max_values;
+        m_header->slot_bytes = slot_bytes;
+        m_header->latest.store(0, std::memory_order_relaxed);
+        for (uint32_t slot_i = 0; slot_i < num_slots; ++slot_i) {
+            new (shm_ring_slot(m_header, slot_i)) ShmSlotHeader{{0}, {0}, {0}, {0.0}};
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(m_header->magic, "SHMR", 4);
+        m_last_publish = std::chrono::steady_clock::now();
+        m_last_check = m_last_publish;
+        m_check_every = 1;
+        m_calls_since_check = 0;
+        return true;
+    }
+
+    void close() {
+        if (m_header != nullptr) {
+            munmap(m_header, m_size);
+            shm_unlink(m_name.c_str());
+            m_header = nullptr;
+        }
+    }
+
+    bool is_open() const { return m_header != nullptr; }
+
+    // Throttle for calling from an observer on every step: true at most every
+    // `min_interval` (a 60 Hz viewer can't show more). Purely time based, whatever a
+    // step costs: the clock is read about every CLOCK_CHECK_PERIOD, and how many calls
+    // that is adapts to the measured step time, so fast steps don't pay for a clock
+    // read each and slow steps still get their frames out
+    bool due(std::chrono::duration<double> min_interval = std::chrono::duration<double>(1.0 / 60.0)) {
+        if (m_header == nullptr || ++m_calls_since_check < m_check_every) {
+            return false;
+        }
+        m_calls_since_check = 0;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration since_check = now - m_last_check;
+        m_last_check = now;
+        if (since_check < CLOCK_CHECK_PERIOD / 2 && m_check_every < MAX_CHECK_EVERY) {
+            m_check_every *= 2;
+        } else if (since_check > CLOCK_CHECK_PERIOD * 2 && m_check_every > 1) {
+            m_check_every /= 2;
+        }
+        return now - m_last_publish >= min_interval;
+    }
+
+    // Values of the next frame, written in place with relaxed stores. Only valid until commit_frame
+    std::atomic<float>* begin_frame() {
+        m_slot = shm_ring_slot(m_header, (m_frame_number + 1) % m_header->num_slots);
+        uint64_t sequence = m_slot->sequence.load(std::memory_order_relaxed);
+        m_slot->sequence.store(sequence + 1, std::memory_order_relaxed); // odd: being written
+        std::atomic_thread_fence(std::memory_order_release);
+        return shm_ring_values(m_slot);
+    }
+
+    void commit_frame(double time, uint64_t num_values) {
+        ++m_frame_number;
+        m_slot->frame_number.store(m_frame_number, std::memory_order_relaxed);
+        m_slot->num_values.store(num_values, std::memory_order_relaxed);
+        m_slot->time.store(time, std::memory_order_relaxed);
+        uint64_t sequence = m_slot->sequence.load(std::memory_order_relaxed);
+        m_slot->sequence.store(sequence + 1, std::memory_order_release); // even again: complete
+        m_header->latest.store(m_frame_number, std::memory_order_release);
+        m_last_publish = std::chrono::steady_clock::now();
+    }
+
+    uint64_t max_values() const { return m_header->max_values; }
+
+private:
+    static constexpr std::chrono::microseconds CLOCK_CHECK_PERIOD{1000};
+    static const int MAX_CHECK_EVERY = 1 << 20;
+
+    std::string m_name;
+    ShmRingHeader* m_header = nullptr;
+    size_t m_size = 0;
+    ShmSlotHeader* m_slot = nullptr;
+    uint64_t m_frame_number = 0;
+    int m_calls_since_check = 0;
+    int m_check_every = 1;
+    std::chrono::steady_clock::time_point m_last_publish;
+    std::chrono::steady_clock::time_point m_last_check;
+};
+
+// One frame as seen by a reader. The values are still in shared memory, so
+// whatever is read from them only counts if end_read says so afterwards
+struct ShmFrameView {
+    const ShmSlotHeader* slot;
+    uint64_t sequence;
+    uint64_t frame_number;
+    uint64_t num_values;
+    double time;
+    const std::atomic<float>* values;
+};
+
+// Reader side: maps the ring read-only, so a viewer can't disturb the simulation
+class ShmSubscriber
+{
+public:
+    ShmSubscriber() = default;
+    ShmSubscriber(const ShmSubscriber&) = delete;
+    ShmSubscriber& operator=(const ShmSubscriber&) = delete;
+    ~ShmSubscriber() { close(); }
+
+    bool open(const std::string& name) {
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            std::cerr << "Could not open shared memory " << name << ", is the simulation running with --publish?" << std::endl;
+            return false;
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(ShmRingHeader)) {
+            std::cerr << "Shared memory " << name << " is too small." << std::endl;
+            ::close(fd);
+            return false;
+        }
+        m_size = file_stat.st_size;
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Could not map shared memory " << name << "." << std::endl;
+            return false;
+        }
+        m_header = static_cast<const ShmRingHeader*>(mapping);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (memcmp(m_header->magic, "SHMR", 4) != 0 || m_header->version != SHM_RING_VERSION
+            || m_size < (sizeof(ShmRingHeader) + 63) / 64 * 64 + m_header->num_slots * m_header->slot_bytes) {
+            std::cerr << name << " is not a shm ring this viewer can read." << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (m_header != nullptr) {
+            munmap(const_cast<ShmRingHeader*>(m_header), m_size);
+            m_header = nullptr;
+        }
+    }
+
+    const ShmRingHeader& header() const { return *m_header; }
+
+    // Start reading the newest committed frame. False if there is none yet or the
+    // writer has already lapped around to it
+    bool begin_read(ShmFrameView& frame) const {
+        uint64_t frame_number = m_header->latest.load(std::memory_order_acquire);
+        if (frame_number == 0) {
+            return false;
+        }
+        const ShmSlotHeader* slot = shm_ring_slot(m_header, frame_number % m_header->num_slots);
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence % 2 == 1) {
+            return false;
+        }
+        frame.slot = slot;
+        frame.sequence = sequence;
+        frame.frame_number = slot->frame_number.load(std::memory_order_relaxed);
+        frame.num_values = std::min(slot->num_values.load(std::memory_order_relaxed), m_header->max_values);
+        frame.time = slot->time.load(std::memory_order_relaxed);
+        frame.values = shm_ring_values(const_cast<ShmSlotHeader*>(slot));
+        return true;
+    }
+
+    // True if nothing in the frame changed while it was being read
+    bool end_read(const ShmFrameView& frame) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return frame.slot->sequence.load(std::memory_order_relaxed) == frame.sequence;
+    }
+
+private:
+    const ShmRingHeader* m_header = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Cell adjacency in compressed sparse row form: the neighbors of cell i are
+// neighbors[row_offsets[i]] .. neighbors[row_offsets[i+1] - 1], so every cell
+// can have its own number of neighbors. Just a view, the arrays live elsewhere
+// (a TissueCSR or a MappedTissue).
+struct TissueGraph {
+    int num_cells;
+    const uint64_t* row_offsets;
+    const int32_t* neighbors;
+};
+
+// Tissue that owns its arrays, e.g. one built from get_grid
+struct TissueCSR {
+    std::vector<uint64_t> row_offsets;
+    std::vector<int32_t> neighbors;
+
+    TissueGraph graph() const {
+        return {static_cast<int>(row_offsets.size()) - 1, row_offsets.data(), neighbors.data()};
+    }
+};
+
+// Drop the -1 "no neighbor" entries of a nested adjacency list
+inline TissueCSR adjs_to_csr(const std::vector<std::vector<int>>& adjs) {
+    TissueCSR tissue;
+    tissue.row_offsets.push_back(0);
+    for (const auto& adj : adjs) {
+        for (int neighbor_i : adj) {
+            if (neighbor_i != -1) {
+                tissue.neighbors.push_back(neighbor_i);
+            }
+        }
+        tissue.row_offsets.push_back(tissue.neighbors.size());
+    }
+    return tissue;
+}
+
+// Helper function to check that the row offsets and neighbor indices stay inside the
+// arrays: offsets start at 0, never decrease and end at num_edges, and every neighbor
+// is a cell. O(cells + edges)
+inline bool check_tissue_bounds(const TissueGraph& tissue, uint64_t num_edges) {
+    if (tissue.row_offsets[0] != 0 || tissue.row_offsets[tissue.num_cells] != num_edges) {
+        std::cerr << "Tissue row offsets don't span its " << num_edges << " edges." << std::endl;
+        return false;
+    }
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        if (tissue.row_offsets[cell_i] > tissue.row_offsets[cell_i + 1]) {
+            std::cerr << "Tissue row offsets decrease at cell " << cell_i << "." << std::endl;
+            return false;
+        }
+    }
+    for (uint64_t edge_i = 0; edge_i < num_edges; ++edge_i) {
+        if (tissue.neighbors[edge_i] < 0 || tissue.neighbors[edge_i] >= tissue.num_cells) {
+            std::cerr << "Tissue edge " << edge_i << " points at cell " << tissue.neighbors[edge_i]
+                      << ", there are only " << tissue.num_cells << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Helper function to check that every link goes both ways (j lists i as often as i
+// lists j), which the ssa relies on. Needs check_tissue_bounds first. Builds the
+// reverse adjacency, so it takes O(edges) extra memory
+inline bool check_tissue_links(const TissueGraph& tissue) {
+    uint64_t num_edges = tissue.row_offsets[tissue.num_cells];
+    std::vector<uint64_t> reverse_offsets(tissue.num_cells + 1, 0);
+    for (uint64_t edge_i = 0; edge_i < num_edges; ++edge_i) {
+        ++reverse_offsets[tissue.neighbors[edge_i] + 1];
+    }
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        reverse_offsets[cell_i + 1] += reverse_offsets[cell_i];
+    }
+    // cells are visited in order, so each reverse row comes out sorted
+    std::vector<int32_t> reverse_neighbors(num_edges);
+    std::vector<uint64_t> next = reverse_offsets;
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        for (uint64_t edge_i = tissue.row_offsets[cell_i]; edge_i < tissue.row_offsets[cell_i + 1]; ++edge_i) {
+            reverse_neighbors[next[tissue.neighbors[edge_i]]++] = cell_i;
+        }
+    }
+    std::vector<int32_t> row;
+    for (int cell_i = 0; cell_i < tissue.num_cells; ++cell_i) {
+        row.assign(tissue.neighbors + tissue.row_offsets[cell_i], tissue.neighbors + tissue.row_offsets[cell_i + 1]);
+        std::sort(row.begin(), row.end());
+        if (!std::equal(row.begin(), row.end(), reverse_neighbors.begin() + reverse_offsets[cell_i],
+                        reverse_neighbors.begin() + reverse_offsets[cell_i + 1])) {
+            std::cerr << "Tissue has a one-way link at cell " << cell_i << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Tissue file layout, everything in native byte order so it can be mapped as is:
+//   char     magic[4] = "TSSU"
+//   uint32_t version
+//   uint64_t num_cells
+//   uint64_t num_edges
+//   uint64_t row_offsets[num_cells + 1]
+//   int32_t  neighbors[num_edges]
+//   int32_t  initial_compartments[num_cells * 3]   (N D Z per cell)
+// Links must go both ways: if j is among i's neighbors, i is among j's (as many
+// times). A rxn only updates the propensities of the neighbors its cell lists, so
+// a one-way link would leave a propensity stale. write_tissue refuses such tissues;
+// `sim_headless delta_notch --validate <path>` checks an existing file
+const uint32_t TISSUE_VERSION = 1;
+
+struct TissueFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t num_cells;
+    uint64_t num_edges;
+};
+
+static_assert(sizeof(int) == sizeof(int32_t), "compartments are stored as int32");
+static_assert(sizeof(TissueFileHeader) == 24, "row_offsets must start 8 byte aligned");
+
+inline bool write_tissue(const std::string& path, const TissueCSR& tissue, const std::vector<int>& initial_compartments) {
+    TissueFileHeader header;
+    memcpy(header.magic, "TSSU", 4);
+    header.version = TISSUE_VERSION;
+    header.num_cells = tissue.row_offsets.empty() ? 0 : tissue.row_offsets.size() - 1;
+    header.num_edges = tissue.neighbors.size();
+    if (initial_compartments.size() != header.num_cells * 3) {
+        std::cerr << "Need 3 initial compartments per cell." << std::endl;
+        return false;
+    }
+    if (tissue.row_offsets.empty() || header.num_cells > INT32_MAX
+        || !check_tissue_bounds(tissue.graph(), header.num_edges) || !check_tissue_links(tissue.graph())) {
+        std::cerr << "Not writing an invalid tissue to " << path << "." << std::endl;
+        return false;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(tissue.row_offsets.data()), tissue.row_offsets.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(tissue.neighbors.data()), tissue.neighbors.size() * sizeof(int32_t));
+    out.write(reinterpret_cast<const char*>(initial_compartments.data()), initial_compartments.size() * sizeof(int32_t));
+    if (!out) {
+        std::cerr << "Could not write tissue " << path << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Read-only memory map of a tissue file. Opening checks the header against the file
+// size and bounds-checks the row offsets and neighbor indices, nothing is copied.
+// It doesn't check that links go both ways (see validate() for that)
+class MappedTissue
+{
+public:
+    MappedTissue() = default;
+    ~MappedTissue() { close(); }
+
+    MappedTissue(const MappedTissue&) = delete;
+    MappedTissue& operator=(const MappedTissue&) = delete;
+
+    bool open(const std::string& path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Could not open " << path << "." << std::endl;
+            return false;
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(TissueFileHeader)) {
+            std::cerr << path << " is too small to be a tissue file." << std::endl;
+            ::close(fd);
+            return false;
+        }
+        m_size = static_cast<size_t>(file_stat.st_size);
+        m_data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (m_data == MAP_FAILED) {
+            std::cerr << "Could not map " << path << "." << std::endl;
+            m_data = nullptr;
+            return false;
+        }
+
+        const TissueFileHeader* header = static_cast<const TissueFileHeader*>(m_data);
+        const char* bytes = static_cast<const char*>(m_data);
+        uint64_t expected_size = sizeof(TissueFileHeader)
+                                 + (header->num_cells + 1) * sizeof(uint64_t)
+                                 + header->num_edges * sizeof(int32_t)
+                                 + header->num_cells * 3 * sizeof(int32_t);
+        if (memcmp(header->magic, "TSSU", 4) != 0 || header->version != TISSUE_VERSION) {
+            std::cerr << path << " is not a version " << TISSUE_VERSION << " tissue file." << std::endl;
+            close();
+            return false;
+        }
+        // counts bigger than the file could wrap expected_size around, so rule them out first
+        if (header->num_cells > INT32_MAX || header->num_edges > m_size || expected_size != m_size) {
+            std::cerr << path << " is truncated or has an inconsistent header." << std::endl;
+            close();
+            return false;
+        }
+
+        m_num_cells = static_cast<int>(header->num_cells);
+        m_row_offsets = reinterpret_cast<const uint64_t*>(bytes + sizeof(TissueFileHeader));
+        m_neighbors = reinterpret_cast<const int32_t*>(m_row_offsets + header->num_cells + 1);
+        m_initial_compartments = reinterpret_cast<const int32_t*>(m_neighbors + header->num_edges);
+        if (!check_tissue_bounds(graph(), header->num_edges)) {
+            std::cerr << path << " is not a valid tissue." << std::endl;
+            close();
+            return false;
+        }
+        // the ssa walks neighbors of random cells, so readahead mostly wastes io
+        madvise(m_data, m_size, MADV_RANDOM);
+        return true;
+    }
+
+    void close()
+    {
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+        m_num_cells = 0;
+    }
+
+    TissueGraph graph() const { return {m_num_cells, m_row_offsets, m_neighbors}; }
+    // Also checks that every link goes both ways, which open leaves out since it needs O(edges) memory
+    bool validate() const { return m_data != nullptr && check_tissue_links(graph()); }
+    const int32_t* initial_compartments() const { return m_initial_compartments; }
+    int num_cells() const { return m_num_cells; }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    int m_num_cells = 0;
+    const uint64_t* m_row_offsets = nullptr;
+    const int32_t* m_neighbors = nullptr;
+    const int32_t* m_initial_compartments = nullptr;
+};
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool where every worker owns a deque of jobs. Workers take their own
+// newest job first and, once they run dry, steal the oldest job from another
+// worker, so a few long jobs never leave the other cores idle.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int num_threads)
+    {
+        if (num_threads < 1) {
+            num_threads = 1;
+        }
+        for (int i = 0; i < num_threads; ++i) {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (int i = 0; i < num_threads; ++i) {
+            m_workers.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wake_lock);
+            m_stopping = true;
+        }
+        m_wake_cv.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void submit(std::function<void()> job)
+    {
+        ++m_pending;
+        WorkerQueue& queue = *m_queues[m_next_queue++ % m_queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_wake_lock);
+            ++m_queued;
+        }
+        m_wake_cv.notify_one();
+    }
+
+    // Block until every submitted job has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_done_lock);
+        m_done_cv.wait(lock, [this] { return m_pending == 0; });
+    }
+
+    int size() const { return static_cast<int>(m_workers.size()); }
+
+private:
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    // Own queue from the back (most recently pushed), everyone else's from the front
+    bool take_job(int worker_i, std::function<void()>& job)
+    {
+        int num_queues = static_cast<int>(m_queues.size());
+        for (int offset = 0; offset < num_queues; ++offset) {
+            WorkerQueue& queue = *m_queues[(worker_i + offset) % num_queues];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (queue.jobs.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            } else {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+            --m_queued;
+            return true;
+        }
+        return false;
+    }
+
+    void worker_loop(int worker_i)
+    {
+        std::function<void()> job;
+        while (true) {
+            if (take_job(worker_i, job)) {
+                job();
+                job = nullptr;
+                if (--m_pending == 0) {
+                    std::lock_guard<std::mutex> lock(m_done_lock);
+                    m_done_cv.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_wake_lock);
+            m_wake_cv.wait(lock, [this] { return m_stopping || m_queued > 0; });
+            if (m_stopping && m_queued == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_next_queue{0};
+    std::atomic<int> m_queued{0};
+    std::atomic<int> m_pending{0};
+    bool m_stopping = false;
+    std::mutex m_wake_lock;
+    std::condition_variable m_wake_cv;
+    std::mutex m_done_lock;
+    std::condition_variable m_done_cv;
+};
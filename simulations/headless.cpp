@@ -0,0 +1,400 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "engine/delta_notch.h"
+#include "engine/instrument.h"
+#include "engine/pso.h"
+#include "engine/random_walk.h"
+#include "engine/shm_ring.h"
+
+using namespace std;
+
+// Runs the engines without SDL, for display-less nodes:
+//   sim_headless pso [flags]
+//   sim_headless delta_notch [flags]
+//   sim_headless random_walk [flags]
+// Flags come in `--name value` pairs, see each run_* function.
+
+// print/write whatever was recorded once the run is done
+void export_instrumentation(const string& trace_path) {
+    if (instrument::enabled) {
+        instrument::print_summary(cout);
+        if (!trace_path.empty()) {
+            instrument::write_chrome_trace(trace_path);
+        }
+    } else if (!trace_path.empty()) {
+        cerr << "--trace needs a build with -DSIM_INSTRUMENT." << endl;
+    }
+}
+
+// Helper functions to write the current state as a frame for shm_viewer (layouts in engine/shm_ring.h)
+void publish_pso(ShmPublisher& publisher, const PSOState& state) {
+    atomic<float>* values = publisher.begin_frame();
+    values[0].store(state.f_center[0], memory_order_relaxed);
+    values[1].store(state.f_center[1], memory_order_relaxed);
+    for (size_t particle_i = 0; particle_i < state.particle_positions.size(); ++particle_i) {
+        values[2 + (2 * particle_i)].store(state.particle_positions[particle_i][0], memory_order_relaxed);
+        values[3 + (2 * particle_i)].store(state.particle_positions[particle_i][1], memory_order_relaxed);
+    }
+    publisher.commit_frame(state.iteration, 2 + (2 * state.particle_positions.size()));
+}
+
+void publish_delta_notch(ShmPublisher& publisher, const SSAState& state) {
+    atomic<float>* values = publisher.begin_frame();
+    for (size_t compartment_i = 0; compartment_i < state.compartments.size(); ++compartment_i) {
+        values[compartment_i].store(state.compartments[compartment_i], memory_order_relaxed);
+    }
+    publisher.commit_frame(state.time, state.compartments.size());
+}
+
+void publish_random_walk(ShmPublisher& publisher, const RandomWalkState& state, const vector<uint32_t>& visits) {
+    atomic<float>* values = publisher.begin_frame();
+    values[0].store(state.x, memory_order_relaxed);
+    values[1].store(state.y, memory_order_relaxed);
+    for (size_t site_i = 0; site_i < visits.size(); ++site_i) {
+        values[2 + site_i].store(visits[site_i], memory_order_relaxed);
+    }
+    publisher.commit_frame(state.steps, 2 + visits.size());
+}
+
+int run_pso_headless(int argc, char* argv[]) {
+    // INTITIALIZATION =============================================================
+    int max_iterations = 2000;
+    PSOConfig config = DEFAULT_PSO_CONFIG;
+    mt19937 gen(314); // supposedly this seeds the rand num generator
+
+    // --iterations <n>
+    // --checkpoint <path> [--checkpoint-every <iterations>] saves the run as it goes
+    // --resume <path> picks a saved run back up (or forks a new one from it)
+    // --sweep <spec> [--out <csv>] [--threads <n>] runs a hyperparameter sweep instead
+    // --islands <n> [--migrate-every <k>] [--migrants <m>] [--topology ring|full] runs an island model instead
+    // --publish <shm name> streams live frames to shm_viewer
+    // --trace <path> writes a chrome trace of the run (needs -DSIM_INSTRUMENT)
+    string publish_name;
+    string checkpoint_path;
+    string resume_path;
+    string trace_path;
+    int checkpoint_every = 100;
+    string sweep_path;
+    string sweep_out_path = "sweep.csv";
+    int num_threads = static_cast<int>(thread::hardware_concurrency());
+    int num_islands = 0;
+    int migrate_every = 50;
+    int num_migrants = 2;
+    MigrationTopology topology = MigrationTopology::ring;
+    for (int arg_i = 0; arg_i + 1 < argc; arg_i += 2) {
+        if (strcmp(argv[arg_i], "--iterations") == 0) {
+            max_iterations = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--checkpoint") == 0) {
+            checkpoint_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--checkpoint-every") == 0) {
+            checkpoint_every = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--resume") == 0) {
+            resume_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--sweep") == 0) {
+            sweep_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--out") == 0) {
+            sweep_out_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--threads") == 0) {
+            num_threads = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--trace") == 0) {
+            trace_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--islands") == 0) {
+            num_islands = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--migrate-every") == 0) {
+            migrate_every = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--migrants") == 0) {
+            num_migrants = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--topology") == 0) {
+            topology = strcmp(argv[arg_i + 1], "full") == 0 ? MigrationTopology::full : MigrationTopology::ring;
+        } else if (strcmp(argv[arg_i], "--publish") == 0) {
+            publish_name = argv[arg_i + 1];
+        }
+    }
+
+    // RUNNING SIMULATION =============================================================
+    if (!sweep_path.empty()) {
+        SweepSpec spec;
+        spec.max_iterations = max_iterations;
+        spec.seed = 314;
+        if (!parse_sweep_spec(sweep_path, spec)) {
+            return 1;
+        }
+        bool sweep_ok = run_sweep(spec, config, sweep_out_path, num_threads);
+        export_instrumentation(trace_path);
+        return sweep_ok ? 0 : 1;
+    }
+
+    if (num_islands > 0) {
+        auto start = chrono::steady_clock::now();
+        vector<IslandResult> results = run_islands(num_islands, config, max_iterations, migrate_every, num_migrants, topology, 314);
+        double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (int island_i = 0; island_i < num_islands; ++island_i) {
+            cout << "island " << island_i << ": final error " << results[island_i].final_error
+                 << ", best personal error " << results[island_i].best_personal_error
+                 << ", migrants received " << results[island_i].migrants_received << endl;
+        }
+        cout << num_islands << " islands x " << max_iterations << " iterations in " << total_s << " s" << endl;
+        export_instrumentation(trace_path);
+        return 0;
+    }
+
+    PSOEngine engine(config, gen);
+    if (!resume_path.empty()) {
+        if (!engine.load_checkpoint(resume_path)) {
+            return 1;
+        }
+        cout << "resuming from iteration " << engine.state().iteration << endl;
+    }
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint_every(checkpoint_path, checkpoint_every);
+    }
+    ShmPublisher publisher;
+    if (!publish_name.empty()) {
+        if (!publisher.open(publish_name, ShmFrameKind::pso, 0, 0, 2 + (2 * config.num_particles))) {
+            return 1;
+        }
+        engine.add_observer([&publisher](const PSOState& state) {
+            if (publisher.due()) {
+                publish_pso(publisher, state);
+            }
+        });
+    }
+    auto start = chrono::steady_clock::now();
+    engine.run_until(max_iterations);
+    double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (publisher.is_open()) {
+        publish_pso(publisher, engine.state()); // the viewer always gets to see where the run ended
+    }
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint(checkpoint_path);
+    }
+    cout << "iteration " << engine.state().iteration << ": swarm error " << swarm_error(engine.state())
+         << " (" << total_s << " s)" << endl;
+    export_instrumentation(trace_path);
+    return 0;
+}
+
+int run_delta_notch_headless(int argc, char* argv[]) {
+    // INTITIALIZATION =============================================================
+    int nx = 8;
+    int ny = 8;
+    double time_end = 10.0;
+    mt19937 gen(314); // supposedly this seeds the rand num generator
+
+    // --nx <n> --ny <n> --time-end <t>
+    // --tissue <path> runs on a memory-mapped tissue file instead of the nx x ny hex grid
+    // --export-tissue <path> writes the hex grid as a tissue file and exits
+    // --validate <path> checks a tissue file, including that every link goes both ways, and exits
+    // --checkpoint <path> [--checkpoint-every <rxns>] saves the run as it goes
+    // --resume <path> picks a saved run back up (or forks a new one from it)
+    // --converge-window <t> [--converge-tolerance <x>] stops early once the pattern's order
+    //     parameter stays within x for t of simulated time. x defaults to a few cells' worth, see
+    //     default_convergence_tolerance
+    // --publish <shm name> streams live frames to shm_viewer
+    // --trace <path> writes a chrome trace of the run (needs -DSIM_INSTRUMENT)
+    string publish_name;
+    string checkpoint_path;
+    string resume_path;
+    string trace_path;
+    string tissue_path;
+    string export_tissue_path;
+    string validate_path;
+    long long checkpoint_every = 10000;
+    ConvergenceCriteria convergence = {0.0, 0.0}; // tolerance 0: scale it to the tissue once it's known
+    for (int arg_i = 0; arg_i + 1 < argc; arg_i += 2) {
+        if (strcmp(argv[arg_i], "--checkpoint") == 0) {
+            checkpoint_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--checkpoint-every") == 0) {
+            checkpoint_every = atoll(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--resume") == 0) {
+            resume_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--trace") == 0) {
+            trace_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--tissue") == 0) {
+            tissue_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--export-tissue") == 0) {
+            export_tissue_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--validate") == 0) {
+            validate_path = argv[arg_i + 1];
+        } else if (strcmp(argv[arg_i], "--nx") == 0) {
+            nx = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--ny") == 0) {
+            ny = atoi(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--time-end") == 0) {
+            time_end = atof(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--converge-window") == 0) {
+            convergence.window = atof(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--converge-tolerance") == 0) {
+            convergence.tolerance = atof(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--publish") == 0) {
+            publish_name = argv[arg_i + 1];
+        }
+    }
+
+    if (!validate_path.empty()) {
+        MappedTissue validated_tissue;
+        if (!validated_tissue.open(validate_path)) {
+            return 1;
+        }
+        if (!validated_tissue.validate()) {
+            cerr << validate_path << " is not a valid tissue." << endl;
+            return 1;
+        }
+        cout << validate_path << ": " << validated_tissue.num_cells() << " cells, ok" << endl;
+        return 0;
+    }
+
+    // tissue is either the mapped file or the hex grid
+    MappedTissue mapped_tissue;
+    TissueCSR grid_tissue;
+    TissueGraph tissue;
+    vector<int> initial_compartments;
+    if (!tissue_path.empty()) {
+        auto map_start = chrono::steady_clock::now();
+        if (!mapped_tissue.open(tissue_path)) {
+            return 1;
+        }
+        tissue = mapped_tissue.graph();
+        initial_compartments.assign(mapped_tissue.initial_compartments(), mapped_tissue.initial_compartments() + tissue.num_cells * 3);
+        double map_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - map_start).count();
+        cout << "mapped " << tissue.num_cells << " cells in " << map_ms << " ms" << endl;
+    } else {
+        // get grid of adjs and initial_compartments
+        auto grid_result = get_grid(nx, ny, gen);
+        grid_tissue = adjs_to_csr(grid_result.first);
+        tissue = grid_tissue.graph();
+        initial_compartments = grid_result.second;
+
+        if (!export_tissue_path.empty()) {
+            return write_tissue(export_tissue_path, grid_tissue, initial_compartments) ? 0 : 1;
+        }
+    }
+
+    DeltaNotchEngine engine(tissue, {initial_compartments, 0.0, gen});
+    if (!resume_path.empty()) {
+        if (!engine.load_checkpoint(resume_path)) {
+            return 1;
+        }
+        cout << "resuming from t = " << engine.state().time << endl;
+    }
+    if (convergence.window > 0.0) {
+        if (convergence.tolerance <= 0.0) {
+            convergence.tolerance = default_convergence_tolerance(tissue.num_cells);
+        } else if (convergence.tolerance < 2.0 / tissue.num_cells) {
+            cerr << "warning: one cell flipping moves the order parameter by 1/" << tissue.num_cells
+                 << ", so --converge-tolerance " << convergence.tolerance << " will rarely be met." << endl;
+        }
+        engine.stop_on_convergence(convergence);
+    }
+
+    // RUNNING SIMULATION =============================================================
+    long long num_rxns = 0;
+    engine.add_observer([&num_rxns](const SSAState&) { ++num_rxns; });
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint_every(checkpoint_path, checkpoint_every);
+    }
+    ShmPublisher publisher;
+    if (!publish_name.empty()) {
+        // a mapped tissue has no grid layout, the viewer lays it out itself
+        uint32_t width = tissue_path.empty() ? nx : 0;
+        uint32_t height = tissue_path.empty() ? ny : 0;
+        if (!publisher.open(publish_name, ShmFrameKind::delta_notch, width, height, static_cast<uint64_t>(tissue.num_cells) * 3)) {
+            return 1;
+        }
+        engine.add_observer([&publisher](const SSAState& state) {
+            if (publisher.due()) {
+                publish_delta_notch(publisher, state);
+            }
+        });
+    }
+    auto start = chrono::steady_clock::now();
+    engine.run_until(time_end);
+    double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (publisher.is_open()) {
+        publish_delta_notch(publisher, engine.state()); // the viewer always gets to see where the run ended
+    }
+    if (!checkpoint_path.empty()) {
+        engine.save_checkpoint(checkpoint_path);
+    }
+    cout << num_rxns << " rxns to t = " << engine.state().time << " in " << total_s << " s"
+         << ", order parameter " << engine.order_parameter() << endl;
+    if (engine.converged()) {
+        cout << "pattern converged, stopped early" << endl;
+    }
+    export_instrumentation(trace_path);
+    return 0;
+}
+
+int run_random_walk_headless(int argc, char* argv[]) {
+    // --steps <n> --seed <s>
+    // --jump <k> gets there in jumps of k steps, each O(1) (see random_walk_jump)
+    // --publish <shm name> streams the walker and its visit density to shm_viewer
+    long long num_steps = 1000000;
+    long long jump_steps = 0;
+    unsigned seed = 314;
+    string publish_name;
+    for (int arg_i = 0; arg_i + 1 < argc; arg_i += 2) {
+        if (strcmp(argv[arg_i], "--steps") == 0) {
+            num_steps = atoll(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--seed") == 0) {
+            seed = static_cast<unsigned>(atoll(argv[arg_i + 1]));
+        } else if (strcmp(argv[arg_i], "--jump") == 0) {
+            jump_steps = atoll(argv[arg_i + 1]);
+        } else if (strcmp(argv[arg_i], "--publish") == 0) {
+            publish_name = argv[arg_i + 1];
+        }
+    }
+
+    RandomWalkEngine engine(100, 100, mt19937(seed));
+    ShmPublisher publisher;
+    vector<uint32_t> visits;
+    if (!publish_name.empty()) {
+        int width = engine.max_x() + 1;
+        int height = engine.max_y() + 1;
+        if (!publisher.open(publish_name, ShmFrameKind::random_walk, width, height, 2 + (static_cast<uint64_t>(width) * height))) {
+            return 1;
+        }
+        visits.assign(width * height, 0);
+        engine.add_observer([&publisher, &visits, width](const RandomWalkState& state) {
+            ++visits[(state.y * width) + state.x];
+            if (publisher.due()) {
+                publish_random_walk(publisher, state, visits);
+            }
+        });
+    }
+    auto start = chrono::steady_clock::now();
+    if (jump_steps > 0) {
+        while (engine.state().steps < num_steps) {
+            engine.jump(min(jump_steps, num_steps - engine.state().steps));
+        }
+    } else {
+        engine.run_until(num_steps);
+    }
+    double total_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (publisher.is_open()) {
+        publish_random_walk(publisher, engine.state(), visits); // the viewer always gets to see where the run ended
+    }
+    cout << "after " << engine.state().steps << " steps the walker is at (" << engine.state().x << ", " << engine.state().y
+         << ") (" << total_s << " s)" << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "pso") == 0) {
+        return run_pso_headless(argc - 2, argv + 2);
+    } else if (argc >= 2 && strcmp(argv[1], "delta_notch") == 0) {
+        return run_delta_notch_headless(argc - 2, argv + 2);
+    } else if (argc >= 2 && strcmp(argv[1], "random_walk") == 0) {
+        return run_random_walk_headless(argc - 2, argv + 2);
+    }
+    cerr << "usage: " << argv[0] << " pso|delta_notch|random_walk [--flag value ...]" << endl;
+    return 1;
+}
@@ -2,6 +2,11 @@
 #include <random>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "engine/random_walk.h"
 
 using namespace std;
 
@@ -9,94 +14,152 @@ const int WINDOW_HEIGHT = 500;
 const int WINDOW_WIDTH = 500;
 const float RENDERER_SCALE = 5.0;
 
-int main()
+const int HISTORY_LENGTH = 5000; // most recent positions drawn each frame
+const double DEFAULT_FRAME_SECONDS = 1.0 / 60.0; // if the display doesn't report its refresh rate
+const double STEP_BUDGET_FRACTION = 0.75; // share of a frame the walk may use, the rest is for drawing and events
+const long long STEPS_PER_CLOCK_CHECK = 4096;
+
+// Last HISTORY_LENGTH positions, oldest first from `next` once full.
+// Fixed size, so millions of steps per frame don't grow memory
+struct PositionRing {
+    vector<int> x;
+    vector<int> y;
+    int next = 0;
+    int size = 0;
+
+    PositionRing() : x(HISTORY_LENGTH), y(HISTORY_LENGTH) {}
+
+    void push(int new_x, int new_y) {
+        x[next] = new_x;
+        y[next] = new_y;
+        next = (next + 1) % HISTORY_LENGTH;
+        size = min(size + 1, HISTORY_LENGTH);
+    }
+};
+
+// Helper function for the seconds between two SDL performance counter readings
+double seconds_between(Uint64 start, Uint64 end) {
+    return static_cast<double>(end - start) / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char* argv[])
 {
+    // --steps-per-second <n> runs the walk at a fixed rate; 0 (the default) runs it as fast as
+    // the frame budget allows, i.e. full speed on one core
+    double steps_per_second = 0.0;
+    for (int arg_i = 1; arg_i + 1 < argc; arg_i += 2) {
+        if (strcmp(argv[arg_i], "--steps-per-second") == 0) {
+            steps_per_second = atof(argv[arg_i + 1]);
+        }
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
     SDL_Window *window;
     SDL_Renderer *renderer;
     window = SDL_CreateWindow("SDL Window",
             SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH,
             WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     SDL_RenderSetScale(renderer, RENDERER_SCALE, RENDERER_SCALE);
 
+    // vsync paces the frames if the renderer honors it, otherwise we sleep to the display's frame period ourselves
+    SDL_RendererInfo renderer_info;
+    SDL_GetRendererInfo(renderer, &renderer_info);
+    bool has_vsync = (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+    double frame_period = DEFAULT_FRAME_SECONDS;
+    SDL_DisplayMode display_mode;
+    if (SDL_GetWindowDisplayMode(window, &display_mode) == 0 && display_mode.refresh_rate > 0) {
+        frame_period = 1.0 / display_mode.refresh_rate;
+    }
+
     // Setup
-    int x = WINDOW_WIDTH/2 /RENDERER_SCALE;
-    int y = WINDOW_HEIGHT/2 /RENDERER_SCALE;
-    vector<int> x_history;
-    vector<int> y_history;
     random_device random_seed;
-    uniform_int_distribution<uint8_t> U(0,4);
+    RandomWalkEngine engine(WINDOW_WIDTH /RENDERER_SCALE, WINDOW_HEIGHT /RENDERER_SCALE, mt19937(random_seed()));
+    PositionRing history;
+    engine.add_observer([&history](const RandomWalkState& state) {
+        history.push(state.x, state.y);
+    });
     cout << "setup done." << endl;
 
     // A basic main loop to prevent blocking
     bool is_running = true;
     SDL_Event event;
+    Uint64 last_frame = SDL_GetPerformanceCounter();
+    Uint64 last_report = last_frame;
+    long long steps_at_last_report = 0;
+    double steps_owed = 0.0; // fixed-rate mode: steps the walk is behind real time
     while (is_running) {
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+        double frame_seconds = seconds_between(last_frame, frame_start);
+        last_frame = frame_start;
+
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 is_running = false;
             }
         }
 
-        uint8_t direction = U(random_seed);
-        switch(direction)
-        {
-            case 0:
-                x += 1;
-                break;
-            case 1:
-                x -= 1;
-                break;
-            case 2:
-                y += 1;
-                break;
-            case 3:
-                y -= 1;
-                break;
+        // SIMULATION ============================================================
+        // The walk runs on its own clock, decoupled from the frame rate: in fixed-rate mode it
+        // catches up on the steps owed since the last frame, otherwise it steps until its
+        // share of the frame is used up. Either way it never runs past the budget, so a slow
+        // frame can't snowball into an ever longer one and the window stays responsive
+        double step_budget = STEP_BUDGET_FRACTION * frame_period;
+        long long steps_this_frame = -1; // -1: as many as the budget allows
+        if (steps_per_second > 0.0) {
+            steps_owed += steps_per_second * frame_seconds;
+            steps_this_frame = static_cast<long long>(steps_owed);
+            steps_owed -= steps_this_frame;
         }
-        // Infinite space
-        if (x > WINDOW_WIDTH /RENDERER_SCALE)
-        {
-            x = 0;
-        } else if (x < 0)
-        {
-            x = WINDOW_WIDTH /RENDERER_SCALE;
-        }
-
-        if (y > WINDOW_HEIGHT /RENDERER_SCALE)
-        {
-            y = 0;
-        } else if (y < 0)
-        {
-            y = WINDOW_HEIGHT /RENDERER_SCALE;
+        long long steps_done = 0;
+        while (steps_this_frame < 0 || steps_done < steps_this_frame) {
+            long long chunk = STEPS_PER_CLOCK_CHECK;
+            if (steps_this_frame >= 0) {
+                chunk = min(chunk, steps_this_frame - steps_done);
+            }
+            engine.run_until(engine.state().steps + chunk);
+            steps_done += chunk;
+            if (seconds_between(frame_start, SDL_GetPerformanceCounter()) > step_budget) {
+                break; // drop whatever is still owed rather than fall further behind
+            }
         }
 
-        x_history.push_back(x);
-        y_history.push_back(y);
-
+        // RENDERING ============================================================
         // Blank black canvas
         SDL_SetRenderDrawColor(renderer,0,0,0,SDL_ALPHA_OPAQUE);
         SDL_RenderClear(renderer);
 
-        // Draw
-        int times = x_history.size();
-        for (int i = max(0, times - 5000); i < times; ++i)
+        // Draw, oldest first so the most recent positions end up on top
+        int oldest = (history.size < HISTORY_LENGTH) ? 0 : history.next;
+        for (int age_i = 0; age_i < history.size; ++age_i)
         {
-            // the higher the i, the more recent
-            int x_to_draw = x_history[i];
-            int y_to_draw = y_history[i];
-            int color = i*255 / times;
+            // the higher the age_i, the more recent
+            int i = (oldest + age_i) % HISTORY_LENGTH;
+            int color = (age_i + 1) * 255 / history.size;
             SDL_SetRenderDrawColor(renderer, color, color, color, SDL_ALPHA_OPAQUE);
-            SDL_RenderDrawPoint(renderer, x_to_draw, y_to_draw);
+            SDL_RenderDrawPoint(renderer, history.x[i], history.y[i]);
         }
 
         // Render
         SDL_RenderPresent(renderer);
-        SDL_Delay();
+        if (!has_vsync) {
+            double frame_left = frame_period - seconds_between(frame_start, SDL_GetPerformanceCounter());
+            if (frame_left > 0.0) {
+                SDL_Delay(static_cast<Uint32>(frame_left * 1000.0));
+            }
+        }
+
+        // throughput once a second
+        double since_report = seconds_between(last_report, SDL_GetPerformanceCounter());
+        if (since_report >= 1.0) {
+            long long steps = engine.state().steps;
+            cout << (steps - steps_at_last_report) / since_report << " steps/s" << endl;
+            steps_at_last_report = steps;
+            last_report = SDL_GetPerformanceCounter();
+        }
     }
-     
+
     SDL_DestroyWindow(window);
     SDL_DestroyRenderer(renderer);
     SDL_Quit();
-}
\ No newline at end of file
+}
@@ -0,0 +1,165 @@
+#include <SDL2/SDL.h>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+
+#include "engine/pso.h"
+#include "engine/shm_ring.h"
+
+using namespace std;
+
+// Watches a run started with `sim_headless <sim> --publish <name>`:
+//   shm_viewer <name>
+// Maps the run's shm ring read-only and draws the newest complete frame straight out
+// of shared memory. The simulation never waits on this process.
+
+const int WINDOW_HEIGHT = 600;
+const int WINDOW_WIDTH = 600;
+
+// Helper function to read one value of a frame
+float value_at(const ShmFrameView& frame, uint64_t value_i) {
+    return frame.values[value_i].load(memory_order_relaxed);
+}
+
+void draw_pso_frame(SDL_Renderer* renderer, const ShmFrameView& frame) {
+    float scale_x = WINDOW_WIDTH / PSO_SPACE_WIDTH;
+    float scale_y = WINDOW_HEIGHT / PSO_SPACE_HEIGHT;
+    for (uint64_t particle_i = 0; 2 + (2 * particle_i) + 1 < frame.num_values; ++particle_i) {
+        if (particle_i % 3 == 0) {
+            SDL_SetRenderDrawColor(renderer, 255, 255, 0, SDL_ALPHA_OPAQUE);
+        } else if (particle_i % 3 == 1) {
+            SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
+        } else {
+            SDL_SetRenderDrawColor(renderer, 255, 0, 255, SDL_ALPHA_OPAQUE);
+        }
+        SDL_Rect particle = {static_cast<int>(value_at(frame, 2 + (2 * particle_i)) * scale_x) - 2,
+                             static_cast<int>(value_at(frame, 3 + (2 * particle_i)) * scale_y) - 2, 4, 4};
+        SDL_RenderFillRect(renderer, &particle);
+    }
+
+    // f_center as a white cross
+    int f_x = static_cast<int>(value_at(frame, 0) * scale_x);
+    int f_y = static_cast<int>(value_at(frame, 1) * scale_y);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
+    SDL_Rect horizontal = {f_x - 6, f_y - 1, 13, 3};
+    SDL_Rect vertical = {f_x - 1, f_y - 6, 3, 13};
+    SDL_RenderFillRect(renderer, &horizontal);
+    SDL_RenderFillRect(renderer, &vertical);
+}
+
+// Cells as squares, rows shifted by half a cell like the hex grid. A tissue file has
+// no layout, so its cells just fill a square in index order
+void draw_delta_notch_frame(SDL_Renderer* renderer, const ShmFrameView& frame, int nx, int ny) {
+    int num_cells = static_cast<int>(frame.num_values / 3);
+    if (nx * ny != num_cells) {
+        nx = static_cast<int>(ceil(sqrt(num_cells)));
+        ny = nx;
+    }
+    int cell_size = max(1, min(WINDOW_WIDTH / (nx + 1), WINDOW_HEIGHT / max(ny, 1)));
+    for (int cell_i = 0; cell_i < num_cells; ++cell_i) {
+        // same cell order as get_grid: i * ny + j
+        int i = cell_i / ny;
+        int j = cell_i % ny;
+        float N = value_at(frame, cell_i * 3);
+        float Z = value_at(frame, (cell_i * 3) + 2);
+        uint8_t cell_color = static_cast<uint8_t>(255.0 * (1.0 - (Z > 0 ? min(N / Z, 1.0f) : 0.0f)));
+        SDL_SetRenderDrawColor(renderer, cell_color, cell_color, cell_color, SDL_ALPHA_OPAQUE);
+        SDL_Rect cell = {(i * cell_size) + ((j % 2) * cell_size / 2), j * cell_size, cell_size, cell_size};
+        SDL_RenderFillRect(renderer, &cell);
+    }
+}
+
+// Visit density on a log scale, walker in red
+void draw_random_walk_frame(SDL_Renderer* renderer, const ShmFrameView& frame, int width, int height) {
+    if (frame.num_values < 2 + static_cast<uint64_t>(width) * height) {
+        return;
+    }
+    float max_visits = 1.0f;
+    for (uint64_t site_i = 0; site_i < static_cast<uint64_t>(width) * height; ++site_i) {
+        max_visits = max(max_visits, value_at(frame, 2 + site_i));
+    }
+    int site_width = max(1, WINDOW_WIDTH / width);
+    int site_height = max(1, WINDOW_HEIGHT / height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float visits = value_at(frame, 2 + (static_cast<uint64_t>(y) * width) + x);
+            uint8_t color = static_cast<uint8_t>(255.0 * log1p(visits) / log1p(max_visits));
+            SDL_SetRenderDrawColor(renderer, color, color, color, SDL_ALPHA_OPAQUE);
+            SDL_Rect site = {x * site_width, y * site_height, site_width, site_height};
+            SDL_RenderFillRect(renderer, &site);
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
+    SDL_Rect walker = {static_cast<int>(value_at(frame, 0)) * site_width, static_cast<int>(value_at(frame, 1)) * site_height,
+                       site_width, site_height};
+    SDL_RenderFillRect(renderer, &walker);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <shm name, e.g. /sim_pso>" << endl;
+        return 1;
+    }
+    ShmSubscriber subscriber;
+    if (!subscriber.open(argv[1])) {
+        return 1;
+    }
+    const ShmRingHeader& header = subscriber.header();
+    ShmFrameKind kind = static_cast<ShmFrameKind>(header.kind);
+    int width = static_cast<int>(header.width);
+    int height = static_cast<int>(header.height);
+
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    window = SDL_CreateWindow("SDL Window",
+            SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH,
+            WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+
+    // A basic main loop to prevent blocking
+    bool is_running = true;
+    SDL_Event event;
+    uint64_t shown_frame_number = 0;
+    while (is_running) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                is_running = false;
+            }
+        }
+
+        // nothing new (or caught mid-write): wait a bit instead of spinning
+        ShmFrameView frame;
+        if (!subscriber.begin_read(frame) || frame.frame_number == shown_frame_number) {
+            SDL_Delay(2);
+            continue;
+        }
+
+        // RENDERING ============================================================
+        // Blank black canvas
+        SDL_SetRenderDrawColor(renderer,0,0,0,SDL_ALPHA_OPAQUE);
+        SDL_RenderClear(renderer);
+
+        if (kind == ShmFrameKind::pso) {
+            draw_pso_frame(renderer, frame);
+        } else if (kind == ShmFrameKind::delta_notch) {
+            draw_delta_notch_frame(renderer, frame, width, height);
+        } else if (kind == ShmFrameKind::random_walk) {
+            draw_random_walk_frame(renderer, frame, width, height);
+        }
+
+        // only show the frame if the simulation didn't write over it while we drew it
+        if (!subscriber.end_read(frame)) {
+            continue;
+        }
+        SDL_RenderPresent(renderer);
+        shown_frame_number = frame.frame_number;
+        SDL_SetWindowTitle(window, ("t = " + to_string(frame.time)).c_str());
+    }
+
+    SDL_DestroyWindow(window);
+    SDL_DestroyRenderer(renderer);
+    SDL_Quit();
+}
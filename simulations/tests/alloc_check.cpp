@@ -0,0 +1,65 @@
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "alloc_counter.h"
+#include "engine/delta_notch.h"
+#include "engine/pso.h"
+#include "engine/random_walk.h"
+
+using namespace std;
+
+// Fails (exit 1) if a step of any engine touches the heap once it is warmed up
+
+// Helper function to report one engine's steady-state allocations
+bool report(const string& name, uint64_t step_allocations, int num_steps) {
+    if (step_allocations != 0) {
+        cerr << name << " allocated " << step_allocations << " times in " << num_steps << " steps." << endl;
+        return false;
+    }
+    cout << name << ": no allocations in " << num_steps << " steps" << endl;
+    return true;
+}
+
+int main() {
+    const int num_steps = 2000;
+    bool all_ok = true;
+
+    // PSO =============================================================
+    {
+        PSOEngine engine(DEFAULT_PSO_CONFIG, mt19937(314));
+        engine.step(); // warm-up
+        uint64_t allocations_before = allocation_count();
+        for (int step = 0; step < num_steps; ++step) {
+            engine.step();
+        }
+        all_ok &= report("PSOEngine::step", allocation_count() - allocations_before, num_steps);
+    }
+
+    // DELTA NOTCH =============================================================
+    {
+        mt19937 gen(314);
+        auto grid_result = get_grid(8, 8, gen);
+        TissueCSR tissue = adjs_to_csr(grid_result.first);
+        DeltaNotchEngine engine(tissue.graph(), {grid_result.second, 0.0, gen});
+        engine.step(); // warm-up
+        uint64_t allocations_before = allocation_count();
+        for (int step = 0; step < num_steps; ++step) {
+            engine.step();
+        }
+        all_ok &= report("DeltaNotchEngine::step", allocation_count() - allocations_before, num_steps);
+    }
+
+    // RANDOM WALK =============================================================
+    {
+        RandomWalkEngine engine(100, 100, mt19937(314));
+        engine.step(); // warm-up
+        uint64_t allocations_before = allocation_count();
+        for (int step = 0; step < num_steps; ++step) {
+            engine.step();
+        }
+        all_ok &= report("RandomWalkEngine::step", allocation_count() - allocations_before, num_steps);
+    }
+
+    return all_ok ? 0 : 1;
+}
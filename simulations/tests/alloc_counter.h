@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new/delete with versions that count every heap
+// allocation, so a program can check that its steady-state steps never allocate.
+// Defines the replacement operators, so include it in exactly one translation unit.
+//
+//   uint64_t before = allocation_count();
+//   step();
+//   bool allocated = allocation_count() != before;
+
+// Keeps gcc from inlining the replacements and then warning that free() is
+// called on memory from operator new
+#if defined(__GNUC__)
+#define ALLOC_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#define ALLOC_COUNTER_NOINLINE
+#endif
+
+inline std::atomic<uint64_t> num_allocations{0};
+
+inline uint64_t allocation_count() {
+    return num_allocations.load(std::memory_order_relaxed);
+}
+
+ALLOC_COUNTER_NOINLINE void* operator new(std::size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+ALLOC_COUNTER_NOINLINE void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+ALLOC_COUNTER_NOINLINE void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+ALLOC_COUNTER_NOINLINE void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+ALLOC_COUNTER_NOINLINE void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+ALLOC_COUNTER_NOINLINE void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
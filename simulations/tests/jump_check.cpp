@@ -0,0 +1,144 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine/random_walk.h"
+
+using namespace std;
+
+// Checks random_walk_jump's positions against the exact distribution of the walk, with a
+// chi-square test per case (fixed seeds, so the result is deterministic). Exit 1 on failure.
+
+const int LATTICE_SIZE = 101; // sites per axis of the viewer's 0..100 lattice
+const int NUM_SAMPLES = 400000;
+
+// Helper function for the exact distribution of x (or y) mod `size` after n steps from 0.
+// One axis moves +1, -1, 0 with probability 1/5, 1/5, 3/5, so its characteristic function on
+// Z_size is (3/5 + 2/5 cos t)^n; inverting it on the size points gives the wrapped pmf exactly
+vector<double> exact_wrapped_pmf(long long n, int size) {
+    vector<double> characteristic(size);
+    for (int j = 0; j < size; ++j) {
+        characteristic[j] = pow(0.6 + 0.4 * cos(2 * M_PI * j / size), static_cast<double>(n));
+    }
+    vector<double> pmf(size);
+    for (int k = 0; k < size; ++k) {
+        double sum = 0.0;
+        for (int j = 0; j < size; ++j) {
+            sum += characteristic[j] * cos(2 * M_PI * static_cast<double>(j) * k / size);
+        }
+        pmf[k] = sum / size;
+    }
+    return pmf;
+}
+
+// Helper function for the exact joint distribution of (dx, dy) after n steps, by stepping the pmf
+// on a (2n + 1) x (2n + 1) grid
+vector<vector<double>> exact_joint_pmf(int n) {
+    int width = 2 * n + 1;
+    vector<vector<double>> pmf(width, vector<double>(width, 0.0));
+    pmf[n][n] = 1.0;
+    for (int step = 0; step < n; ++step) {
+        vector<vector<double>> next(width, vector<double>(width, 0.0));
+        for (int x = 0; x < width; ++x) {
+            for (int y = 0; y < width; ++y) {
+                double p = pmf[x][y] / 5.0;
+                if (p == 0.0) {
+                    continue;
+                }
+                next[x][y] += p;
+                if (x + 1 < width) next[x + 1][y] += p;
+                if (x > 0) next[x - 1][y] += p;
+                if (y + 1 < width) next[x][y + 1] += p;
+                if (y > 0) next[x][y - 1] += p;
+            }
+        }
+        pmf = next;
+    }
+    return pmf;
+}
+
+// Chi-square of observed counts against expected probabilities, pooling every bin that
+// expects fewer than 5 samples into one. Passes below df + 4 sqrt(2 df) (about 4 sigma)
+bool chi_square_check(const string& name, const vector<double>& probabilities, const vector<long long>& counts, long long num_samples) {
+    double chi_square = 0.0;
+    int num_bins = 0;
+    double pooled_expected = 0.0;
+    long long pooled_observed = 0;
+    for (size_t bin_i = 0; bin_i < probabilities.size(); ++bin_i) {
+        double expected = probabilities[bin_i] * num_samples;
+        if (expected < 5.0) {
+            pooled_expected += expected;
+            pooled_observed += counts[bin_i];
+            continue;
+        }
+        chi_square += (counts[bin_i] - expected) * (counts[bin_i] - expected) / expected;
+        ++num_bins;
+    }
+    if (pooled_expected >= 5.0) {
+        chi_square += (pooled_observed - pooled_expected) * (pooled_observed - pooled_expected) / pooled_expected;
+        ++num_bins;
+    }
+    int df = num_bins - 1;
+    double limit = df + 4.0 * sqrt(2.0 * df);
+    bool passed = chi_square < limit;
+    cout << name << ": chi-square " << chi_square << " with " << df << " df (limit " << limit << ")"
+         << (passed ? "" : "  FAILED") << endl;
+    return passed;
+}
+
+// Jumps of n steps from the corner (0, 0) of a size x size lattice, x and y marginals
+bool check_wrapped(long long n, int size, unsigned seed) {
+    RandomWalkState state = {0, 0, 0, mt19937(seed)};
+    vector<long long> x_counts(size, 0);
+    vector<long long> y_counts(size, 0);
+    for (int sample = 0; sample < NUM_SAMPLES; ++sample) {
+        state.x = 0;
+        state.y = 0;
+        random_walk_jump(state, n, size - 1, size - 1);
+        ++x_counts[state.x];
+        ++y_counts[state.y];
+    }
+    vector<double> pmf = exact_wrapped_pmf(n, size);
+    string name = "jump " + to_string(n) + (n < JUMP_NORMAL_MIN_STEPS ? " (exact)" : " (normal)") + " on " + to_string(size);
+    bool x_ok = chi_square_check(name + " x", pmf, x_counts, NUM_SAMPLES);
+    bool y_ok = chi_square_check(name + " y", pmf, y_counts, NUM_SAMPLES);
+    return x_ok && y_ok;
+}
+
+// Jumps of n steps from the middle against the exact joint (dx, dy), so x and y have to be
+// dependent the right way too. n is small enough that nothing wraps
+bool check_joint(int n, unsigned seed) {
+    int center = LATTICE_SIZE / 2;
+    int width = 2 * n + 1;
+    RandomWalkState state = {center, center, 0, mt19937(seed)};
+    vector<long long> counts(width * width, 0);
+    for (int sample = 0; sample < NUM_SAMPLES; ++sample) {
+        state.x = center;
+        state.y = center;
+        random_walk_jump(state, n, LATTICE_SIZE - 1, LATTICE_SIZE - 1);
+        ++counts[((state.x - center + n) * width) + (state.y - center + n)];
+    }
+    vector<vector<double>> joint = exact_joint_pmf(n);
+    vector<double> probabilities;
+    for (const vector<double>& row : joint) {
+        probabilities.insert(probabilities.end(), row.begin(), row.end());
+    }
+    return chi_square_check("jump " + to_string(n) + " (exact) joint", probabilities, counts, NUM_SAMPLES);
+}
+
+int main() {
+    bool all_ok = true;
+    all_ok &= check_joint(1, 1);
+    all_ok &= check_joint(20, 2);
+    all_ok &= check_wrapped(300, LATTICE_SIZE, 3);
+    // either side of the switch to the normal limit
+    all_ok &= check_wrapped(JUMP_NORMAL_MIN_STEPS - 1, LATTICE_SIZE, 4);
+    all_ok &= check_wrapped(JUMP_NORMAL_MIN_STEPS, LATTICE_SIZE, 5);
+    all_ok &= check_wrapped(1000000000LL, LATTICE_SIZE, 6);
+    // by here the viewer's lattice is close to uniform, so also check the normal limit's
+    // shape on a lattice too big to wrap much (sd ~ 63 sites)
+    all_ok &= check_wrapped(JUMP_NORMAL_MIN_STEPS, 2001, 7);
+    return all_ok ? 0 : 1;
+}
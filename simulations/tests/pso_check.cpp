@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine/pso.h"
+
+using namespace std;
+
+// Checks the pso runs that have to come out a certain way: a run stopped at a
+// checkpoint and resumed in a new engine ends in exactly the same state as an
+// uninterrupted one, and no island starts on the objective. Exit 1 on failure.
+
+// No island may start with a particle right on the objective: if the objective rng
+// repeats a particle rng's draws, the first f_center lands on that island's particle 0
+// and its best personal error is 0 from the start
+bool check_island_starts() {
+    const int num_islands = 4;
+    vector<IslandResult> results = run_islands(num_islands, DEFAULT_PSO_CONFIG, 100, 0, 0, MigrationTopology::ring, 314);
+    bool all_ok = true;
+    for (int island_i = 0; island_i < num_islands; ++island_i) {
+        bool ok = results[island_i].best_personal_error > 0.0;
+        cout << "island " << island_i << ": best personal error " << results[island_i].best_personal_error
+             << (ok ? "" : "  FAILED") << endl;
+        all_ok &= ok;
+    }
+    return all_ok;
+}
+
+// Helper function to run 2000 iterations in one go and as 1000 + checkpoint + 1000 in an
+// engine that starts from another seed, and compare the two
+bool check_resume(const string& checkpoint_path) {
+    PSOEngine uninterrupted(DEFAULT_PSO_CONFIG, mt19937(314));
+    uninterrupted.run_until(2000);
+
+    {
+        PSOEngine first_half(DEFAULT_PSO_CONFIG, mt19937(314));
+        first_half.run_until(1000);
+        first_half.save_checkpoint(checkpoint_path);
+    }
+    // the fresh engine starts from something else entirely, everything has to come from the file
+    PSOEngine resumed(DEFAULT_PSO_CONFIG, mt19937(0));
+    bool loaded = resumed.load_checkpoint(checkpoint_path);
+    remove(checkpoint_path.c_str());
+    if (loaded) {
+        resumed.run_until(2000);
+    }
+
+    const PSOState& expected = uninterrupted.state();
+    const PSOState& actual = resumed.state();
+    bool ok = loaded
+              && actual.iteration == expected.iteration
+              && actual.particle_positions == expected.particle_positions
+              && actual.particle_velocities == expected.particle_velocities
+              && actual.particle_best_positions == expected.particle_best_positions
+              && actual.f_center == expected.f_center
+              && actual.gen == expected.gen;
+    cout << "resumed at iteration 1000: swarm error " << swarm_error(actual) << " vs " << swarm_error(expected)
+         << (ok ? "" : "  FAILED") << endl;
+    return ok;
+}
+
+int main() {
+    bool all_ok = true;
+    all_ok &= check_resume("pso_check.ck");
+    all_ok &= check_island_starts();
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine/delta_notch.h"
+
+using namespace std;
+
+// Checks that how a delta-notch run is sliced up doesn't change it: the same run to
+// t = 10 in one call, in many short calls, and stopped at a checkpoint and resumed
+// in a new engine has to end in exactly the same state. Also that step() on a tissue
+// with no rxns left leaves time alone. Exit 1 on failure.
+
+struct RunResult {
+    SSAState state;
+    long long num_rxns;
+};
+
+// Helper function to run the default 8x8 grid to `time_end` in calls of `dt` (0: one call)
+RunResult run_in_slices(double time_end, double dt) {
+    mt19937 gen(314);
+    auto grid_result = get_grid(8, 8, gen);
+    TissueCSR tissue = adjs_to_csr(grid_result.first);
+    DeltaNotchEngine engine(tissue.graph(), {grid_result.second, 0.0, gen});
+    long long num_rxns = 0;
+    engine.add_observer([&num_rxns](const SSAState&) { ++num_rxns; });
+    if (dt <= 0.0) {
+        engine.run_until(time_end);
+    } else {
+        for (int slice = 1; slice * dt <= time_end + 1e-9; ++slice) {
+            engine.run_until(slice * dt);
+        }
+    }
+    return {engine.state(), num_rxns};
+}
+
+// Helper function to run to `checkpoint_time`, save, and finish the run in a fresh
+// engine resumed from the end-of-run checkpoint
+RunResult run_with_resume(double checkpoint_time, double time_end, const string& checkpoint_path) {
+    mt19937 gen(314);
+    auto grid_result = get_grid(8, 8, gen);
+    TissueCSR tissue = adjs_to_csr(grid_result.first);
+    long long num_rxns = 0;
+    {
+        DeltaNotchEngine engine(tissue.graph(), {grid_result.second, 0.0, gen});
+        engine.add_observer([&num_rxns](const SSAState&) { ++num_rxns; });
+        engine.run_until(checkpoint_time);
+        engine.save_checkpoint(checkpoint_path);
+    }
+    // the fresh engine starts from something else entirely, everything has to come from the file
+    DeltaNotchEngine engine(tissue.graph(), {grid_result.second, 0.0, mt19937(0)});
+    if (!engine.load_checkpoint(checkpoint_path)) {
+        return {engine.state(), -1};
+    }
+    engine.add_observer([&num_rxns](const SSAState&) { ++num_rxns; });
+    engine.run_until(time_end);
+    remove(checkpoint_path.c_str());
+    return {engine.state(), num_rxns};
+}
+
+// Helper function to compare two runs and report
+bool same_run(const string& name, const RunResult& expected, const RunResult& actual) {
+    bool same = expected.num_rxns == actual.num_rxns
+                && expected.state.compartments == actual.state.compartments
+                && expected.state.gen == actual.state.gen;
+    cout << name << ": " << actual.num_rxns << " rxns vs " << expected.num_rxns
+         << (same ? "" : "  FAILED") << endl;
+    return same;
+}
+
+// A tissue with no rxns left: step() has no target time to run on to, so time must stay put
+bool check_step_without_rxns() {
+    mt19937 gen(314);
+    auto grid_result = get_grid(2, 2, gen);
+    TissueCSR tissue = adjs_to_csr(grid_result.first);
+    DeltaNotchEngine engine(tissue.graph(), {vector<int>(grid_result.second.size(), 0), 0.0, gen});
+    bool fired = engine.step();
+    bool ok = !fired && engine.state().time == 0.0;
+    cout << "step without rxns: fired " << fired << ", t = " << engine.state().time << (ok ? "" : "  FAILED") << endl;
+    return ok;
+}
+
+int main() {
+    bool all_ok = true;
+    RunResult one_call = run_in_slices(10.0, 0.0);
+    all_ok &= same_run("dt = 0.01", one_call, run_in_slices(10.0, 0.01));
+    all_ok &= same_run("dt = 0.001", one_call, run_in_slices(10.0, 0.001));
+    all_ok &= same_run("resumed at t = 5", one_call, run_with_resume(5.0, 10.0, "ssa_check.ck"));
+    all_ok &= check_step_without_rxns();
+    return all_ok ? 0 : 1;
+}